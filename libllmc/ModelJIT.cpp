@@ -0,0 +1,132 @@
+/*
+ * LLMC - LLVM IR Model Checker
+ * Copyright © 2013-2021 Freark van der Berg
+ *
+ * This file is part of LLMC.
+ *
+ * LLMC is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * LLMC is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LLMC.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include <llmc/ModelJIT.h>
+
+#include <llvm/ExecutionEngine/Orc/ExecutionUtils.h>
+#include <llvm/ExecutionEngine/Orc/JITTargetMachineBuilder.h>
+#include <llvm/IR/Module.h>
+#include <llvm/Support/TargetSelect.h>
+
+namespace llmc {
+
+using namespace llvm;
+
+ModelJIT::ModelJIT(MessageFormatter& out)
+    : _jit(nullptr)
+    , _out(out)
+    , _initialized(false)
+    {
+}
+
+ModelJIT::~ModelJIT() {
+    deinitialize();
+}
+
+bool ModelJIT::reportIfError(Error err, std::string const& what) {
+    if(err) {
+        _out.reportError(what + ": " + toString(std::move(err)));
+        return true;
+    }
+    return false;
+}
+
+bool ModelJIT::addModule(orc::ThreadSafeModule tsm) {
+    if(!tsm) {
+        _out.reportError("No model module to JIT");
+        return false;
+    }
+
+    if(!_jit) {
+        InitializeNativeTarget();
+        InitializeNativeTargetAsmPrinter();
+
+        auto jtmb = orc::JITTargetMachineBuilder::detectHost();
+        if(!jtmb) {
+            reportIfError(jtmb.takeError(), "Could not detect host");
+            return false;
+        }
+
+        // Same optimization level as the llc invocation of the file-based path
+        jtmb->setCodeGenOptLevel(CodeGenOpt::Aggressive);
+
+        // The model is generated with its own data layout, so the JIT needs
+        // to use that one instead of the one of the host
+        DataLayout dl = tsm.withModuleDo([](Module& m) { return m.getDataLayout(); });
+
+        auto jit = orc::LLJITBuilder()
+                .setJITTargetMachineBuilder(std::move(*jtmb))
+                .setDataLayout(dl)
+                .create();
+        if(!jit) {
+            reportIfError(jit.takeError(), "Could not create JIT");
+            return false;
+        }
+        _jit = std::move(*jit);
+
+        // The DMC API is implemented by the model checker and exported by
+        // the llmc binary, so resolve against the running process
+        auto gen = orc::DynamicLibrarySearchGenerator::GetForCurrentProcess(dl.getGlobalPrefix());
+        if(!gen) {
+            reportIfError(gen.takeError(), "Could not resolve process symbols");
+            return false;
+        }
+        _jit->getMainJITDylib().addGenerator(std::move(*gen));
+    }
+
+    return !reportIfError(_jit->addIRModule(std::move(tsm)), "Could not add model to JIT");
+}
+
+bool ModelJIT::initialize() {
+    if(!_jit) {
+        _out.reportError("No JIT to initialize");
+        return false;
+    }
+
+    // Runs llvm.global_ctors of the model and the LLMC VM
+    if(reportIfError(_jit->initialize(_jit->getMainJITDylib()), "Could not run the constructors of the model")) {
+        return false;
+    }
+    _initialized = true;
+    return true;
+}
+
+void ModelJIT::deinitialize() {
+    if(!_initialized) {
+        return;
+    }
+    _initialized = false;
+    reportIfError(_jit->deinitialize(_jit->getMainJITDylib()), "Could not run the destructors of the model");
+}
+
+void* ModelJIT::lookup(std::string const& name) {
+    if(!_jit) {
+        _out.reportError("No JIT to look up " + name + " in");
+        return nullptr;
+    }
+    auto sym = _jit->lookup(name);
+    if(!sym) {
+        reportIfError(sym.takeError(), "Could not find " + name);
+        return nullptr;
+    }
+    return reinterpret_cast<void*>(static_cast<uintptr_t>(sym->getAddress()));
+}
+
+} // namespace llmc
@@ -0,0 +1,221 @@
+/*
+ * LLMC - LLVM IR Model Checker
+ * Copyright © 2013-2021 Freark van der Berg
+ *
+ * This file is part of LLMC.
+ *
+ * LLMC is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * LLMC is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LLMC.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <llmc/analysis/Escape.h>
+#include <llmc/analysis/Footprint.h>
+
+#include <llvm/Analysis/CFG.h>
+#include <llvm/IR/Constants.h>
+#include <llvm/IR/IntrinsicInst.h>
+
+namespace llmc {
+
+bool EscapeAnalysis::Provenance::add(Provenance const& other) {
+    bool changed = false;
+    if(other.unknown && !unknown) {
+        unknown = true;
+        changed = true;
+    }
+    for(auto object: other.objects) {
+        changed |= objects.insert(object).second;
+    }
+    return changed;
+}
+
+EscapeAnalysis::EscapeAnalysis(Module& module)
+: _module(module)
+{
+}
+
+EscapeAnalysis::~EscapeAnalysis() = default;
+
+bool EscapeAnalysis::isSlot(Value* V) {
+    if(!isa<AllocaInst>(V)) return false;
+    for(auto U: V->users()) {
+        if(auto L = dyn_cast<LoadInst>(U)) {
+            if(L->getPointerOperand() != V) return false;
+        } else if(auto S = dyn_cast<StoreInst>(U)) {
+            if(S->getPointerOperand() != V || S->getValueOperand() == V) return false;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool EscapeAnalysis::isEscapingUse(Instruction* I, unsigned operand) {
+    switch(I->getOpcode()) {
+        case Instruction::Load:
+        case Instruction::GetElementPtr:
+        case Instruction::BitCast:
+        case Instruction::AddrSpaceCast:
+        case Instruction::PHI:
+        case Instruction::Select:
+        case Instruction::ICmp:
+            return false;
+        case Instruction::Store:
+            // Storing the pointer in a slot is tracked by the provenance
+            return operand == 0 && !isSlot(cast<StoreInst>(I)->getPointerOperand());
+        case Instruction::AtomicRMW:
+        case Instruction::AtomicCmpXchg:
+            return operand != 0;
+        case Instruction::Call: {
+            auto call = cast<CallInst>(I);
+            if(isa<DbgInfoIntrinsic>(call) || call->isLifetimeStartOrEnd()) {
+                return false;
+            }
+            if(isa<MemIntrinsic>(call)) {
+                return false;
+            }
+            return true;
+        } default:
+            return true;
+    }
+}
+
+EscapeAnalysis::Provenance EscapeAnalysis::provenanceOf(FunctionInfo& info, Value* V) {
+    Provenance p;
+    if(!V->getType()->isPointerTy()) {
+        return p;
+    }
+    if(isa<Instruction>(V)) {
+        return info.provenance[V];
+    }
+    if(auto C = dyn_cast<Constant>(V)) {
+        auto object = C->stripPointerCasts();
+        if(isa<ConstantPointerNull>(object) || isa<UndefValue>(object) || isa<Function>(object)) {
+            return p;
+        }
+    }
+
+    // Arguments, globals and constant expressions: memory that other
+    // processes may know about
+    p.unknown = true;
+    return p;
+}
+
+EscapeAnalysis::Provenance EscapeAnalysis::transfer(FunctionInfo& info, Instruction* I) {
+    Provenance p;
+    switch(I->getOpcode()) {
+        case Instruction::Alloca:
+            p.objects.insert(I);
+            break;
+        case Instruction::Call:
+            if(FootprintAnalysis::isAllocationSite(I)) {
+                p.objects.insert(I);
+            } else {
+                p.unknown = true;
+            }
+            break;
+        case Instruction::GetElementPtr:
+        case Instruction::BitCast:
+        case Instruction::AddrSpaceCast:
+            p = provenanceOf(info, I->getOperand(0));
+            break;
+        case Instruction::PHI:
+            for(auto& incoming: cast<PHINode>(I)->incoming_values()) {
+                p.add(provenanceOf(info, incoming));
+            }
+            break;
+        case Instruction::Select:
+            p.add(provenanceOf(info, I->getOperand(1)));
+            p.add(provenanceOf(info, I->getOperand(2)));
+            break;
+        case Instruction::Load: {
+            auto slot = cast<LoadInst>(I)->getPointerOperand();
+            if(isSlot(slot)) {
+                for(auto U: slot->users()) {
+                    if(auto S = dyn_cast<StoreInst>(U)) {
+                        p.add(provenanceOf(info, S->getValueOperand()));
+                    }
+                }
+            } else {
+                p.unknown = true;
+            }
+            break;
+        } default:
+            p.unknown = true;
+            break;
+    }
+    return p;
+}
+
+EscapeAnalysis::FunctionInfo& EscapeAnalysis::getInfo(Function* F) {
+    auto& info = _functions[F];
+    if(info) {
+        return *info;
+    }
+    info = std::make_unique<FunctionInfo>();
+
+    // Provenance is a fixpoint, because of PHI nodes and slots
+    bool changed = true;
+    while(changed) {
+        changed = false;
+        for(auto& BB: *F) {
+            for(auto& I: BB) {
+                if(!I.getType()->isPointerTy()) continue;
+                changed |= info->provenance[&I].add(transfer(*info, &I));
+            }
+        }
+    }
+
+    // The escapes of every object
+    for(auto& BB: *F) {
+        for(auto& I: BB) {
+            for(unsigned op = 0; op < I.getNumOperands(); ++op) {
+                if(!isEscapingUse(&I, op)) continue;
+                auto p = provenanceOf(*info, I.getOperand(op));
+                for(auto object: p.objects) {
+                    info->escapes[object].push_back(&I);
+                }
+            }
+        }
+    }
+    return *info;
+}
+
+bool EscapeAnalysis::isThreadLocal(Instruction* I, Value* pointer) {
+    auto& info = getInfo(I->getFunction());
+    auto p = provenanceOf(info, pointer);
+    if(p.unknown || p.objects.empty()) {
+        return false;
+    }
+    for(auto object: p.objects) {
+        auto it = info.escapes.find(object);
+        if(it == info.escapes.end()) continue;
+        for(auto escape: it->second) {
+            if(isPotentiallyReachable(escape, I)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool EscapeAnalysis::isThreadLocalAccess(Instruction* I) {
+    if(auto L = dyn_cast<LoadInst>(I)) {
+        return !L->isAtomic() && !L->isVolatile() && isThreadLocal(I, L->getPointerOperand());
+    }
+    if(auto S = dyn_cast<StoreInst>(I)) {
+        return !S->isAtomic() && !S->isVolatile() && isThreadLocal(I, S->getPointerOperand());
+    }
+    return false;
+}
+
+} // namespace llmc
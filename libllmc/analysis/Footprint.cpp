@@ -0,0 +1,214 @@
+/*
+ * LLMC - LLVM IR Model Checker
+ * Copyright © 2013-2021 Freark van der Berg
+ *
+ * This file is part of LLMC.
+ *
+ * LLMC is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * LLMC is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LLMC.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <llmc/analysis/Escape.h>
+#include <llmc/analysis/Footprint.h>
+
+#include <vector>
+
+#include <llvm/Analysis/ValueTracking.h>
+#include <llvm/IR/Constants.h>
+#include <llvm/IR/IntrinsicInst.h>
+
+namespace llmc {
+
+FootprintAnalysis::FootprintAnalysis(Module& module, EscapeAnalysis* escape)
+: _module(module)
+, _escape(escape)
+{
+}
+
+bool FootprintAnalysis::isAllocationSite(Value* V) {
+    auto call = dyn_cast<CallBase>(V);
+    if(!call) return false;
+    auto F = call->getCalledFunction();
+    return F && F->isDeclaration() && F->getName().equals("malloc");
+}
+
+Value* FootprintAnalysis::objectOf(Value* pointer) {
+    auto object = const_cast<Value*>(getUnderlyingObject(pointer));
+    if(isa<AllocaInst>(object) || isa<GlobalVariable>(object) || isAllocationSite(object)) {
+        return object;
+    }
+    return nullptr;
+}
+
+void FootprintAnalysis::addRead(Value* pointer, Footprint& fp) {
+    if(auto object = objectOf(pointer)) {
+        fp.reads.insert(object);
+    } else {
+        fp.opaque = true;
+    }
+}
+
+void FootprintAnalysis::addWrite(Value* pointer, Footprint& fp) {
+    if(auto object = objectOf(pointer)) {
+        fp.writes.insert(object);
+    } else {
+        fp.opaque = true;
+    }
+}
+
+void FootprintAnalysis::add(Instruction* I, Footprint& fp) {
+    if(_escape && _escape->isThreadLocalAccess(I)) {
+        return;
+    }
+    switch(I->getOpcode()) {
+        case Instruction::Load: {
+            auto L = cast<LoadInst>(I);
+            if(L->isAtomic() || L->isVolatile()) {
+                fp.opaque = true;
+            } else {
+                addRead(L->getPointerOperand(), fp);
+            }
+            return;
+        } case Instruction::Store: {
+            auto S = cast<StoreInst>(I);
+            if(S->isAtomic() || S->isVolatile()) {
+                fp.opaque = true;
+            } else {
+                addWrite(S->getPointerOperand(), fp);
+            }
+            return;
+        } case Instruction::Fence:
+        case Instruction::AtomicCmpXchg:
+        case Instruction::AtomicRMW:
+            fp.opaque = true;
+            return;
+        case Instruction::Ret:
+        case Instruction::Unreachable:
+            // The end of a thread is observed by pthread_join
+            fp.opaque = true;
+            return;
+        case Instruction::Call: {
+            auto call = cast<CallInst>(I);
+            if(isa<DbgInfoIntrinsic>(call)) {
+                return;
+            }
+            if(call->isLifetimeStartOrEnd()) {
+                return;
+            }
+            if(auto mt = dyn_cast<MemTransferInst>(call)) {
+                addWrite(mt->getRawDest(), fp);
+                addRead(mt->getRawSource(), fp);
+                return;
+            }
+            if(auto ms = dyn_cast<MemSetInst>(call)) {
+                addWrite(ms->getRawDest(), fp);
+                return;
+            }
+            if(call->getIntrinsicID() != Intrinsic::not_intrinsic && !call->mayReadOrWriteMemory()) {
+                return;
+            }
+
+            // Allocation only touches the memory of the executing process
+            if(isAllocationSite(call)) {
+                return;
+            }
+            fp.opaque = true;
+            return;
+        } default:
+            if(I->mayReadOrWriteMemory()) {
+                fp.opaque = true;
+            }
+            return;
+    }
+}
+
+bool FootprintAnalysis::onlyAccessed(Value* object, bool allowStores) {
+    std::vector<Value*> todo{object};
+    std::unordered_set<Value*> seen{object};
+    auto derived = [&](Value* V) {
+        if(seen.insert(V).second) {
+            todo.push_back(V);
+        }
+    };
+    while(!todo.empty()) {
+        Value* V = todo.back();
+        todo.pop_back();
+        for(auto U: V->users()) {
+            if(auto L = dyn_cast<LoadInst>(U)) {
+                if(L->getPointerOperand() != V) return false;
+            } else if(auto S = dyn_cast<StoreInst>(U)) {
+                if(S->getValueOperand() == V) return false;
+                if(!allowStores) return false;
+            } else if(isa<GetElementPtrInst>(U) || isa<BitCastInst>(U) || isa<AddrSpaceCastInst>(U)
+                   || isa<PHINode>(U) || isa<SelectInst>(U)) {
+                derived(U);
+            } else if(auto CE = dyn_cast<ConstantExpr>(U)) {
+                if(CE->getOpcode() != Instruction::GetElementPtr && !CE->isCast()) return false;
+                if(CE->getOpcode() == Instruction::PtrToInt) return false;
+                derived(CE);
+            } else if(isa<ICmpInst>(U)) {
+                continue;
+            } else if(isa<DbgInfoIntrinsic>(U)) {
+                continue;
+            } else if(isa<IntrinsicInst>(U) && cast<IntrinsicInst>(U)->isLifetimeStartOrEnd()) {
+                continue;
+            } else if(auto mt = dyn_cast<MemTransferInst>(U)) {
+                if(mt->getRawDest() == V && !allowStores) return false;
+                if(mt->getLength() == V) return false;
+            } else if(auto ms = dyn_cast<MemSetInst>(U)) {
+                if(ms->getRawDest() != V || !allowStores) return false;
+            } else {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool FootprintAnalysis::isThreadLocal(Value* object) {
+    auto it = _threadLocal.find(object);
+    if(it != _threadLocal.end()) {
+        return it->second;
+    }
+    bool local = (isa<AllocaInst>(object) || isAllocationSite(object)) && onlyAccessed(object, true);
+    _threadLocal[object] = local;
+    return local;
+}
+
+bool FootprintAnalysis::isReadOnly(Value* object) {
+    auto it = _readOnly.find(object);
+    if(it != _readOnly.end()) {
+        return it->second;
+    }
+    bool readOnly = false;
+    auto GV = dyn_cast<GlobalVariable>(object);
+    if(GV && GV->hasInitializer()) {
+        readOnly = GV->isConstant() || onlyAccessed(GV, false);
+    }
+    _readOnly[object] = readOnly;
+    return readOnly;
+}
+
+bool FootprintAnalysis::isIndependent(Footprint const& fp) {
+    if(fp.opaque) {
+        return false;
+    }
+    for(auto object: fp.writes) {
+        if(!isThreadLocal(object)) return false;
+    }
+    for(auto object: fp.reads) {
+        if(!isThreadLocal(object) && !isReadOnly(object)) return false;
+    }
+    return true;
+}
+
+} // namespace llmc
@@ -0,0 +1,114 @@
+/*
+ * LLMC - LLVM IR Model Checker
+ * Copyright © 2013-2021 Freark van der Berg
+ *
+ * This file is part of LLMC.
+ *
+ * LLMC is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * LLMC is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LLMC.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <llmc/analysis/Liveness.h>
+
+#include <llvm/IR/CFG.h>
+
+namespace llmc {
+
+RegisterLiveness::RegisterLiveness(Function& F) {
+
+    // Number the registers like createRegisterMapping() does
+    for(auto& A: F.args()) {
+        _index[&A] = _registers.size();
+        _registers.push_back(&A);
+    }
+    for(auto& BB: F) {
+        for(auto& I: BB) {
+            if(!I.getType()->isVoidTy()) {
+                _index[&I] = _registers.size();
+                _registers.push_back(&I);
+            }
+        }
+    }
+
+    // Fixpoint over the live-in sets of the blocks
+    std::unordered_map<BasicBlock*, BitVector> liveIn;
+    for(auto& BB: F) {
+        liveIn[&BB] = BitVector(_registers.size());
+    }
+    bool changed = true;
+    while(changed) {
+        changed = false;
+        for(auto& BB: F) {
+            BitVector in = scan(&BB, liveOut(&BB, liveIn), false);
+            if(in != liveIn[&BB]) {
+                liveIn[&BB] = std::move(in);
+                changed = true;
+            }
+        }
+    }
+
+    // Record the live registers at every instruction
+    for(auto& BB: F) {
+        scan(&BB, liveOut(&BB, liveIn), true);
+    }
+}
+
+int RegisterLiveness::indexOf(Value* V) const {
+    auto it = _index.find(V);
+    return it == _index.end() ? -1 : it->second;
+}
+
+void RegisterLiveness::addUses(Instruction* I, BitVector& live) const {
+    for(auto& op: I->operands()) {
+        int idx = indexOf(op.get());
+        if(idx >= 0) {
+            live.set(idx);
+        }
+    }
+}
+
+BitVector RegisterLiveness::liveOut(BasicBlock* BB, std::unordered_map<BasicBlock*, BitVector> const& liveIn) const {
+    BitVector live(_registers.size());
+    for(auto succ: successors(BB)) {
+        BitVector in = liveIn.at(succ);
+
+        // The branch writes the PHI registers using the incoming values
+        for(auto& phi: succ->phis()) {
+            in.reset(indexOf(&phi));
+            int idx = indexOf(phi.getIncomingValueForBlock(BB));
+            if(idx >= 0) {
+                in.set(idx);
+            }
+        }
+        live |= in;
+    }
+    return live;
+}
+
+BitVector RegisterLiveness::scan(BasicBlock* BB, BitVector live, bool record) {
+    for(auto it = BB->rbegin(); it != BB->rend(); ++it) {
+        Instruction* I = &*it;
+        if(!isa<PHINode>(I)) {
+            int idx = indexOf(I);
+            if(idx >= 0) {
+                live.reset(idx);
+            }
+            addUses(I, live);
+        }
+        if(record) {
+            _liveAt[I] = live;
+        }
+    }
+    return live;
+}
+
+} // namespace llmc
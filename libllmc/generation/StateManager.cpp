@@ -22,13 +22,16 @@
 
 namespace llmc {
 
-static void checkIsMultipleOf(LLDMCModelGenerator* gen, Value* v, Value* multipleOf, std::string ass, std::string function) {
+static void checkIsMultipleOf(LLDMCModelGenerator* gen, Value* v, uint64_t multipleOf, std::string ass, std::string function) {
+    if(!gen->needsRuntimeCheck(gen->proveIsMultipleOf(v, multipleOf), ass + " in " + function)) {
+        return;
+    }
     if(v->getType()->isIntegerTy()) {
         v = gen->builder.CreateIntCast(v, gen->t_int64, false);
     } else if(v->getType()->isPointerTy()) {
         v = gen->builder.CreatePtrToInt(v, gen->t_int64);
     }
-    v = gen->builder.CreateAnd(v, gen->builder.CreateIntCast(multipleOf, gen->t_int64, false));
+    v = gen->builder.CreateAnd(v, ConstantInt::get(gen->t_int64, multipleOf - 1));
     auto cmp = gen->builder.CreateICmpEQ(v, ConstantInt::get(gen->t_int64, 0));
 //    auto BBEnd = BasicBlock::Create(gen->ctx, "is_not_multiple_of_end", gen->builder.GetInsertBlock()->getParent());
 //    llvmgen::If2 genIf(gen->builder, cmp, "is_not_multiple_of", BBEnd);
@@ -52,6 +55,9 @@ static void checkIsMultipleOf(LLDMCModelGenerator* gen, Value* v, Value* multipl
 }
 
 Value* StateManager::upload(Value* data, Value* length) {
+    if(gen->isBigChunkType(type)) {
+        return uploadBytes(data, toBytes(length));
+    }
     auto& dmc_insert = gen->f_dmc_insert;
     assert(dmc_insert);
     assert(data);
@@ -68,7 +74,7 @@ Value* StateManager::upload(Value* data, Value* length) {
 }
 
 Value* StateManager::uploadBytes(Value* data, Value* lengthInBytes) {
-    auto& dmc_insert = gen->f_dmc_insertBytes;
+    auto& dmc_insert = gen->isBigChunkType(type) ? gen->f_dmc_big_insert : gen->f_dmc_insertBytes;
     assert(dmc_insert);
     assert(data);
     assert(data->getType()->isPointerTy());
@@ -104,13 +110,13 @@ Value* StateManager::upload(Value* stateID, Value* data, Value* length) {
 Value* StateManager::uploadBytes(Value* stateID, Value* data, Value* lengthInBytes) {
     assert(lengthInBytes);
     assert(lengthInBytes->getType()->isIntegerTy());
-    checkIsMultipleOf(gen, lengthInBytes, ConstantInt::get(gen->t_int64, 4), "Length is not multiple of 4", "uploadBytes");
+    checkIsMultipleOf(gen, lengthInBytes, 4, "Length is not multiple of 4", "uploadBytes");
     auto length = gen->builder.CreateUDiv(lengthInBytes, ConstantInt::get(lengthInBytes->getType(), 4));
     return upload(stateID, data, length);
 }
 
 Value* StateManager::download(Value* stateID, Value* data) {
-    auto& dmc_get = gen->f_dmc_get;
+    auto& dmc_get = gen->isBigChunkType(type) ? gen->f_dmc_big_get : gen->f_dmc_get;
     assert(dmc_get);
     assert(stateID);
     assert(data);
@@ -153,6 +159,9 @@ Value* StateManager::delta(Value* stateID, Value* offset, Value* data) {
 }
 
 Value* StateManager::delta(Value* stateID, Value* offset, Value* length, Value* data) {
+    if(gen->isBigChunkType(type)) {
+        return deltaBytes(stateID, toBytes(offset), toBytes(length), data);
+    }
     auto& dmc_delta = gen->f_dmc_delta;
     assert(dmc_delta);
     assert(stateID);
@@ -189,7 +198,7 @@ Value* StateManager::deltaBytes(Value* stateID, Value* offsetInBytes, Value* dat
 }
 
 Value* StateManager::deltaBytes(Value* stateID, Value* offsetInBytes, Value* lengthInBytes, Value* data) {
-    auto& dmc_delta = gen->f_dmc_deltaBytes;
+    auto& dmc_delta = gen->isBigChunkType(type) ? gen->f_dmc_big_delta : gen->f_dmc_deltaBytes;
     assert(dmc_delta);
     assert(stateID);
     assert(offsetInBytes);
@@ -219,6 +228,9 @@ Value* StateManager::deltaBytes(Value* stateID, Value* offsetInBytes, Value* len
 }
 
 Value* StateManager::downloadPart(Value* stateID, Value* offset, Value* length, Value* data) {
+    if(gen->isBigChunkType(type)) {
+        return downloadPartBytes(stateID, toBytes(offset), toBytes(length), data);
+    }
     auto& dmc_getpart = gen->f_dmc_getpart;
     assert(dmc_getpart);
     assert(stateID);
@@ -246,7 +258,7 @@ Value* StateManager::downloadPart(Value* stateID, Value* offset, Value* length,
 }
 
 Value* StateManager::downloadPartBytes(Value* stateID, Value* offsetInBytes, Value* lengthInBytes, Value* data) {
-    auto& dmc_getpart = gen->f_dmc_getpartBytes;
+    auto& dmc_getpart = gen->isBigChunkType(type) ? gen->f_dmc_big_getpart : gen->f_dmc_getpartBytes;
     assert(dmc_getpart);
     assert(lengthInBytes);
     assert(lengthInBytes->getType()->isIntegerTy());
@@ -275,7 +287,58 @@ Value* StateManager::downloadPartBytes(Value* stateID, Value* offsetInBytes, Val
 }
 
 
+Value* StateManager::compareAndDeltaBytes(Value* pStateID, Value* offsetInBytes, Value* expected, Value* desired, Value*& loaded) {
+    auto& builder = gen->builder;
+    assert(pStateID);
+    assert(pStateID->getType()->isPointerTy());
+    assert(offsetInBytes);
+    assert(offsetInBytes->getType()->isIntegerTy());
+    assert(expected);
+    assert(desired);
+    assert(expected->getType() == desired->getType());
+    auto valueType = expected->getType();
+    auto size = gen->generateSizeOf(valueType);
+
+    // Compare the value in the chunk to the expected value
+    auto current = gen->addAlloca(valueType, builder.GetInsertBlock()->getParent());
+    downloadPartBytes(pStateID, offsetInBytes, size, current);
+    auto load = builder.CreateLoad(valueType, current, "cam_loaded");
+    load->setAlignment(Align(1));
+    loaded = load;
+    auto success = builder.CreateICmpEQ(loaded, expected, "cam_success");
+
+    // Split before the insertion point, or at the end of the block
+    Instruction* placeholder = nullptr;
+    if(builder.GetInsertPoint() == builder.GetInsertBlock()->end()) {
+        placeholder = builder.CreateUnreachable();
+        builder.SetInsertPoint(placeholder);
+    }
+    auto next = &*builder.GetInsertPoint();
+
+    // Only a successful comparison modifies the chunk
+    builder.SetInsertPoint(SplitBlockAndInsertIfThen(success, next, false));
+    auto newValue = gen->addAlloca(valueType, builder.GetInsertBlock()->getParent());
+    builder.CreateStore(desired, newValue)->setAlignment(Align(1));
+    auto newStateID = deltaBytes(pStateID, offsetInBytes, size, newValue);
+    builder.CreateStore(newStateID, pStateID)->setAlignment(Align(1));
+
+    if(placeholder) {
+        auto BB = placeholder->getParent();
+        placeholder->eraseFromParent();
+        builder.SetInsertPoint(BB);
+    } else {
+        builder.SetInsertPoint(next);
+    }
+    return success;
+}
+
+Value* StateManager::toBytes(Value* lengthInWords) {
+    assert(lengthInWords->getType()->isIntegerTy());
+    return gen->builder.CreateMul(lengthInWords, ConstantInt::get(lengthInWords->getType(), 4));
+}
+
 Value* StateManager::getLength(Value* stateID) {
+    assert(!gen->isBigChunkType(type));
     return gen->builder.CreateLShr(stateID, 40);
 }
 
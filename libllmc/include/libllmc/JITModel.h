@@ -0,0 +1,57 @@
+/*
+ * LLMC - LLVM IR Model Checker
+ * Copyright © 2013-2021 Freark van der Berg
+ *
+ * This file is part of LLMC.
+ *
+ * LLMC is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * LLMC is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LLMC.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <dmc/model.h>
+
+/**
+ * @class JITModel
+ * @file JITModel.h
+ * @brief A DMC model whose dmc_initialstate and dmc_nextstates were
+ * compiled in-process, instead of loaded from a shared object like
+ * DMCModel does.
+ */
+class JITModel: public VModel<llmc::storage::StorageInterface> {
+public:
+    using dmc_initialstate_t = size_t(*)(void* ctx);
+    using dmc_nextstates_t = size_t(*)(void* ctx, size_t stateID);
+
+    JITModel(dmc_initialstate_t initialstate, dmc_nextstates_t nextstates)
+    : _initialstate(initialstate)
+    , _nextstates(nextstates)
+    {
+    }
+
+    size_t getNextAll(StateID const& s, Context* ctx) override {
+        return _nextstates(ctx, s.getData());
+    }
+
+    size_t getInitial(Context* ctx) override {
+        return _initialstate(ctx);
+    }
+
+    llmc::statespace::Type* getStateVectorType() override {
+        return nullptr;
+    }
+
+private:
+    dmc_initialstate_t _initialstate;
+    dmc_nextstates_t _nextstates;
+};
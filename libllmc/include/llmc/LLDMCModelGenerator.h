@@ -25,6 +25,7 @@
 #include <cstdio>
 #include <iostream>
 #include <ostream>
+#include <set>
 #include <sstream>
 #include <stack>
 #include <sys/mman.h>
@@ -43,6 +44,10 @@
 #include <llmc/generation/LLVMLTSType.h>
 #include <llmc/generation/ProcessStack.h>
 #include <llmc/generation/TransitionGroups.h>
+#include <llmc/analysis/Escape.h>
+#include <llmc/analysis/Footprint.h>
+#include <llmc/analysis/Liveness.h>
+#include <llmc/analysis/ThreadCount.h>
 
 #include "llvmgen.h"
 
@@ -70,8 +75,15 @@ struct FunctionData {
      */
     std::vector<Type*> registerTypes;
 
+    /**
+     * The number of bytes needed to store the registers, rounded up to
+     * whole slots
+     */
+    size_t registerSize;
+
     FunctionData()
     : registerLayout(nullptr)
+    , registerSize(0)
     {
     }
 };
@@ -95,6 +107,30 @@ public:
         ENDED_FAILURE,
     };
 
+    /**
+     * @brief How the runtime checks of the generated code are handled
+     *   - None: no checks are generated
+     *   - Static: checks are proven at generation time where possible, the
+     *     rest are not generated
+     *   - Full: all checks are generated
+     * A check that is proven to always fail is reported and, unless checks
+     * are disabled, generated.
+     */
+    enum class Checks {
+        None,
+        Static,
+        Full,
+    };
+
+    /**
+     * @brief The outcome of trying to prove a runtime check at generation time
+     */
+    enum class CheckProof {
+        Unknown,
+        Holds,
+        Fails,
+    };
+
     friend class ProcessStack;
 
 public:
@@ -139,7 +175,21 @@ public:
     llvm::Constant* ptr_offset_location;
     llvm::Constant* ptr_mask_location;
 
-    static int const MAX_THREADS = 6;
+    /**
+     * Number of processes used when it is neither specified nor inferable
+     */
+    static int const DEFAULT_MAX_THREADS = 6;
+
+    /**
+     * Number of processes in the state-vector, 0 means infer it
+     */
+    int maxThreads;
+
+    /**
+     * Upper bound on the number of processes, imposed by the 8 bits of the
+     * creator ID in a model pointer
+     */
+    static int const MAX_PROCESSES = 255;
     static int const BITWIDTH_STATEVAR = 32;
     llvm::Constant* c_bytewidth_statevar;
     static int const BITWIDTH_INT = 32;
@@ -149,6 +199,7 @@ public:
     llvm::Constant* c_globalMemStart;
 
     llvm::Function* f_stepProcess;
+    std::vector<llvm::Function*> f_stepProcessSpecialized;
     llvm::Function* f_dmc_nextstates;
     llvm::Function* f_dmc_initialstate;
     llvm::Function* f_constructorStart;
@@ -162,6 +213,14 @@ public:
     llvm::Function* f_dmc_deltaBytes;
     llvm::Function* f_dmc_getpart;
     llvm::Function* f_dmc_getpartBytes;
+    llvm::Function* f_dmc_big_insert;
+    llvm::Function* f_dmc_big_delta;
+    llvm::Function* f_dmc_big_get;
+    llvm::Function* f_dmc_big_getpart;
+    llvm::Function* f_vmGetChunk;
+    llvm::Function* f_vmPutChunk;
+    llvm::Function* f_vmReadMemory;
+    llvm::Function* f_vmWriteMemory;
 
     llvm::BasicBlock* f_pins_getnext_end;
     llvm::BasicBlock* f_pins_getnext_end_report;
@@ -204,24 +263,183 @@ public:
 
 //    std::unordered_map<std::string, Function*> hookedFunctions;
 
-    bool debugChecks;
+    Checks checks;
+    size_t checksEmitted;
+    size_t checksProven;
+    size_t checksElided;
     bool _assumeNonAtomicCollapsable;
+    bool _specializeStepProcess;
+    bool _reportDeltas;
+    bool _partialOrderReduction;
+    bool _collapseThreadLocal;
+    bool _zeroDeadRegisters;
+    bool _inlineLeafFrames;
+    bool _heapGC;
+    bool _heapSymmetry;
+    bool _threadSymmetry;
+    bool _pagedMemory;
+    size_t _bigChunkThreshold;
+    bool _coalesceStores;
+    bool _memoryView;
     SVTypeManager typeManager;
 
+    /**
+     * Types of which the chunks are stored using the dmc_big_* API.
+     */
+    std::unordered_set<SVType*> bigChunkTypes;
+
+    /**
+     * Register liveness per function, computed when first needed.
+     */
+    std::unordered_map<Function*, std::unique_ptr<RegisterLiveness>> registerLiveness;
+    size_t zeroingPoints;
+    size_t zeroedRegisters;
+
+    /**
+     * Functions of which the registers are placed after those of their
+     * caller, at inlineFrameOffset, instead of in a register frame.
+     */
+    std::unordered_set<Function*> inlineFrameFunctions;
+    size_t inlineFrameOffset;
+
+    /**
+     * Functions of which all memory allocated during a call can be
+     * released when the call returns.
+     */
+    std::unordered_set<Function*> frameScopedFunctions;
+
+    /**
+     * The allocation site of every alloca and malloc() call, used by
+     * heap_symmetry, and per site the type of the objects allocated there,
+     * or nullptr if it is not known. Site 0 is no site.
+     */
+    std::unordered_map<Instruction*, uint32_t> allocationSites;
+    std::vector<Type*> allocationSiteTypes;
+
+    /**
+     * Statistics of the register frames saved at call sites.
+     */
+    size_t callSites;
+    size_t inlinedFrames;
+    size_t registerFrames;
+    size_t registerFrameBytes;
+    size_t registerFrameBytesFull;
+
+    /**
+     * The possible targets of an indirect call, per function type as given
+     * by getIndirectCallKey(): the defined functions of which the address is
+     * taken.
+     */
+    std::unordered_map<FunctionType*, std::vector<Function*>> indirectCallTargets;
+
+    /**
+     * Indirect calls with at most this many possible targets are dispatched
+     * using a switch over the targets.
+     */
+    static size_t const MAX_INDIRECT_CALL_TARGETS = 16;
+
+    /**
+     * Statistics of the indirect calls.
+     */
+    size_t indirectCalls;
+    size_t indirectCallsDispatched;
+
+    /**
+     * Decides which loads and stores are thread-local, if enabled.
+     */
+    std::unique_ptr<EscapeAnalysis> escapeAnalysis;
+
+    /**
+     * Per program location, whether the transition of a process at that
+     * location is independent of all other processes.
+     */
+    std::vector<bool> ampleLocations;
+
+    /**
+     * Per program location, the register size of the function it is in.
+     */
+    GlobalVariable* g_registerSizes;
+
+    /**
+     * Per program location, the index of the function it is in, used by
+     * thread_symmetry to group the threads by their start routine.
+     */
+    GlobalVariable* g_locationFunctions;
+
+    /**
+     * The offsets of the pointers in the globals and, concatenated per
+     * function, in the registers, used by heap_symmetry. Per program
+     * location, the index of the first offset in g_registerPointers of the
+     * function it is in and the number of offsets.
+     */
+    GlobalVariable* g_globalPointers;
+    GlobalVariable* g_registerPointers;
+    GlobalVariable* g_registerPointerStart;
+    GlobalVariable* g_registerPointerCount;
+    size_t globalPointerCount;
+
+    /**
+     * Per allocation site, the index of the first offset in g_sitePointers,
+     * the number of offsets and the size of the type of the site, by which
+     * the offsets repeat in an object, used by heap_symmetry.
+     */
+    GlobalVariable* g_sitePointers;
+    GlobalVariable* g_sitePointerStart;
+    GlobalVariable* g_sitePointerCount;
+    GlobalVariable* g_siteStride;
+
 public:
     LLDMCModelGenerator(std::unique_ptr<llvm::Module> modul, MessageFormatter& out)
         : up_module(std::move(modul))
         , ctx(up_module->getContext())
         , t_statevector(nullptr)
+        , maxThreads(0)
         , s_statevector(nullptr)
         , builder(ctx)
         , nextProgramLocation(1)
         , out(out)
         , roout(out.getConsoleWriter().ss())
         , stack(this)
-        , debugChecks(false)
+        , checks(Checks::Full)
+        , checksEmitted(0)
+        , checksProven(0)
+        , checksElided(0)
         , _assumeNonAtomicCollapsable(false)
+        , _specializeStepProcess(false)
+        , _reportDeltas(false)
+        , _partialOrderReduction(false)
+        , _collapseThreadLocal(false)
+        , _zeroDeadRegisters(false)
+        , _inlineLeafFrames(false)
+        , _heapGC(false)
+        , _heapSymmetry(false)
+        , _threadSymmetry(false)
+        , _pagedMemory(false)
+        , _bigChunkThreshold(0)
+        , _coalesceStores(false)
+        , _memoryView(false)
         , typeManager(this)
+        , zeroingPoints(0)
+        , zeroedRegisters(0)
+        , inlineFrameOffset(0)
+        , callSites(0)
+        , inlinedFrames(0)
+        , registerFrames(0)
+        , registerFrameBytes(0)
+        , registerFrameBytesFull(0)
+        , indirectCalls(0)
+        , indirectCallsDispatched(0)
+        , g_registerSizes(nullptr)
+        , g_locationFunctions(nullptr)
+        , g_globalPointers(nullptr)
+        , g_registerPointers(nullptr)
+        , g_registerPointerStart(nullptr)
+        , g_registerPointerCount(nullptr)
+        , globalPointerCount(0)
+        , g_sitePointers(nullptr)
+        , g_sitePointerStart(nullptr)
+        , g_sitePointerCount(nullptr)
+        , g_siteStride(nullptr)
         {
         module = up_module.get();
         dmcModule = nullptr;
@@ -300,16 +518,464 @@ public:
     }
 
     /**
-     * @brief
+     * @brief Sets how the runtime checks of the generated code are handled,
+     * see Checks.
      */
-     void enableDebugChecks() {
-         debugChecks = true;
-     }
+    void setChecks(Checks c) {
+        checks = c;
+    }
 
      void assumeNonAtomicCollapsable() {
          _assumeNonAtomicCollapsable = true;
      }
 
+    /**
+     * @brief Generate a copy of the step function per process, in which the
+     * processor ID is a constant, instead of a single one that takes it as
+     * an argument.
+     */
+    void specializeStepProcess() {
+        _specializeStepProcess = true;
+    }
+
+    /**
+     * @brief Report successors of process steps as a delta of the changed
+     * part of the root, relative to the source state, instead of inserting
+     * the complete root.
+     */
+    void reportDeltas() {
+        _reportDeltas = true;
+    }
+
+    /**
+     * @brief Explore only a single process in states where the next
+     * transition of that process is provably independent of all other
+     * processes.
+     */
+    void partialOrderReduction() {
+        _partialOrderReduction = true;
+    }
+
+    /**
+     * @brief Treat loads and stores of memory that no other process can
+     * access at that point as invisible, so they are collapsed into the
+     * surrounding transition group.
+     */
+    void collapseThreadLocal() {
+        _collapseThreadLocal = true;
+    }
+
+    /**
+     * @brief Zero the registers that are dead at the destination of every
+     * transition group. Experimental: this has not been validated against
+     * full exploration, nor has a reduction of the number of states been
+     * measured.
+     */
+    void zeroDeadRegisters() {
+        _zeroDeadRegisters = true;
+    }
+
+    /**
+     * @brief Place the registers of non-recursive leaf functions after the
+     * registers of their caller, such that calling them does not need to
+     * save the registers of the caller in a register frame.
+     */
+    void inlineLeafFrames() {
+        _inlineLeafFrames = true;
+    }
+
+    /**
+     * @brief Collect the unreachable heap objects of a process every time a
+     * state is emitted, such that states that only differ in garbage are the
+     * same state.
+     */
+    void heapGarbageCollection() {
+        _heapGC = true;
+    }
+
+    /**
+     * @brief Relabel the heap objects of a process every time a state is
+     * emitted, such that states that only differ in the order in which
+     * objects were allocated are the same state.
+     */
+    void heapSymmetry() {
+        _heapSymmetry = true;
+    }
+
+    /**
+     * @brief Place the running threads that have no memory in a canonical
+     * order in every emitted state, grouped by start routine, such that
+     * states that only differ in which process slots these threads run in
+     * are the same state. Thread IDs are not renumbered.
+     */
+    void threadSymmetry() {
+        _threadSymmetry = true;
+    }
+
+    /**
+     * @brief Store the memory of a process as a tree of fixed-size pages
+     * instead of as a single chunk, such that a store only creates a new
+     * page and the path to it, and untouched pages are shared between
+     * states. The tree is handled by llmc_paged_*() of the VM.
+     */
+    void pagedMemory() {
+        _pagedMemory = true;
+    }
+
+    /**
+     * @brief Store the memory and register chunks using the dmc_big_* API
+     * when they can be @c bytes or larger, see determineBigChunkTypes().
+     * If 0, the dmc_big_* API is not used.
+     */
+    void bigChunkThreshold(size_t bytes) {
+        _bigChunkThreshold = bytes;
+    }
+
+    /**
+     * @brief Buffer the loads and stores of a transition group that follow
+     * each other and write the stores to the memory chunk as a single delta,
+     * instead of creating a chunk per store that no state refers to. The
+     * buffer is handled by llmc_store_buffer_*() of the VM.
+     */
+    void coalesceStores() {
+        _coalesceStores = true;
+    }
+
+    /**
+     * @brief Keep a window of the memory read during a step, such that
+     * loads close to an earlier load are served without the storage. The
+     * window is handled by llmc_memory_view_*() of the VM.
+     */
+    void memoryView() {
+        _memoryView = true;
+    }
+
+    /**
+     * @brief Returns whether the chunks of @c type are stored using the
+     * dmc_big_* API.
+     */
+    bool isBigChunkType(SVType* type) const {
+        return bigChunkTypes.count(type) > 0;
+    }
+
+    /**
+     * @brief Returns whether every object in memory, also allocas, has an
+     * object header that the VM can walk.
+     */
+    bool trackObjects() const {
+        return _heapGC || _heapSymmetry;
+    }
+
+    /**
+     * @brief Returns whether @c I is a load or store that escape analysis
+     * has shown to be thread-local.
+     */
+    bool isThreadLocalAccess(Instruction* I) {
+        return escapeAnalysis && escapeAnalysis->isThreadLocalAccess(I);
+    }
+
+    /**
+     * @brief Runs the escape analysis and reports how many loads and stores
+     * it found to be thread-local.
+     */
+    void determineThreadLocalAccesses() {
+        escapeAnalysis = std::make_unique<EscapeAnalysis>(*module);
+        size_t accesses = 0;
+        size_t threadLocal = 0;
+        for(auto& F: *module) {
+            if(F.isDeclaration()) continue;
+            for(auto& BB: F) {
+                for(auto& I: BB) {
+                    if(!isa<LoadInst>(I) && !isa<StoreInst>(I)) continue;
+                    accesses++;
+                    if(isThreadLocalAccess(&I)) {
+                        threadLocal++;
+                    }
+                }
+            }
+        }
+        out.reportNote("Escape analysis: " + std::to_string(threadLocal) + " of "
+                       + std::to_string(accesses) + " loads and stores are thread-local");
+    }
+
+    /**
+     * @brief Determines the functions that get an inlined frame: defined
+     * functions that do not call other defined functions, and thus are not
+     * recursive, and that are only called directly. At most one such frame
+     * is active per process.
+     */
+    void determineInlineFrames() {
+        inlineFrameFunctions.clear();
+        for(auto& F: *module) {
+            if(F.isDeclaration() || F.use_empty() || F.hasAddressTaken()) continue;
+            bool leaf = true;
+            for(auto& BB: F) {
+                for(auto& I: BB) {
+                    if(pushesStackFrame(&I)) {
+                        leaf = false;
+                    }
+                }
+            }
+            if(leaf) {
+                inlineFrameFunctions.insert(&F);
+            }
+        }
+        out.reportNote("Inlined frames: " + std::to_string(inlineFrameFunctions.size()) + " leaf functions");
+    }
+
+    /**
+     * @brief Returns @c type with every pointer parameter and a pointer return
+     * type replaced by i8*. Functions of which the types only differ in the
+     * types pointed to can be called through the same function pointer,
+     * e.g. overrides of a C++ virtual method, which differ in the type of
+     * @c this.
+     */
+    FunctionType* getIndirectCallKey(FunctionType* type) {
+        auto erase = [this](Type* t) {
+            return t->isPointerTy() ? t_voidp : t;
+        };
+        std::vector<Type*> params;
+        for(auto param: type->params()) {
+            params.push_back(erase(param));
+        }
+        return FunctionType::get(erase(type->getReturnType()), params, type->isVarArg());
+    }
+
+    /**
+     * @brief Determines the allocation sites, see allocationSites. The type
+     * of an alloca is its allocated type. The type of a malloc() call is the
+     * one its result is cast to, if every use of the result is a cast to the
+     * same pointer type or a call to free(); otherwise it is not known.
+     */
+    void determineAllocationSites() {
+        allocationSites.clear();
+        allocationSiteTypes.assign(1, nullptr);
+        size_t typed = 0;
+        for(auto& F: *module) {
+            for(auto& BB: F) {
+                for(auto& I: BB) {
+                    Type* type = nullptr;
+                    if(auto alloca = dyn_cast<AllocaInst>(&I)) {
+                        type = alloca->getAllocatedType();
+                    } else if(auto call = dyn_cast<CallInst>(&I)) {
+                        auto callee = call->getCalledFunction();
+                        if(!callee || !callee->getName().equals("malloc")) continue;
+                        for(auto user: call->users()) {
+                            auto cast = dyn_cast<BitCastInst>(user);
+                            auto userCall = dyn_cast<CallInst>(user);
+                            if(cast && (!type || type == cast->getDestTy()->getPointerElementType())) {
+                                type = cast->getDestTy()->getPointerElementType();
+                            } else if(userCall && userCall->getCalledFunction() && userCall->getCalledFunction()->getName().equals("free")) {
+                            } else {
+                                type = nullptr;
+                                break;
+                            }
+                        }
+                    } else {
+                        continue;
+                    }
+                    if(type && !type->isSized()) {
+                        type = nullptr;
+                    }
+                    typed += type != nullptr;
+                    allocationSites[&I] = allocationSiteTypes.size();
+                    allocationSiteTypes.push_back(type);
+                }
+            }
+        }
+        out.reportNote("Allocation sites: " + std::to_string(typed) + " of " + std::to_string(allocationSites.size())
+                       + " have a known type");
+    }
+
+    /**
+     * @brief Returns the allocation site of @c I, or 0 if it has none.
+     */
+    uint32_t getAllocationSite(Instruction* I) {
+        auto it = allocationSites.find(I);
+        return it == allocationSites.end() ? 0 : it->second;
+    }
+
+    /**
+     * @brief Determines the possible targets of indirect calls: the defined
+     * functions of which the address is taken, grouped by compatible
+     * function types, see getIndirectCallKey().
+     */
+    void determineIndirectCallTargets() {
+        indirectCallTargets.clear();
+        for(auto& F: *module) {
+            if(F.isDeclaration() || !F.hasAddressTaken()) continue;
+            indirectCallTargets[getIndirectCallKey(F.getFunctionType())].push_back(&F);
+        }
+    }
+
+    /**
+     * @brief Determines the functions of which the memory allocated during a
+     * call can be released on return. Allocas and malloc() share the memory
+     * of a process, so these are the functions that cannot call malloc(),
+     * directly or via any function they may call. When objects are tracked,
+     * the other functions release only their stack objects on return.
+     */
+    void determineFrameScopedFunctions() {
+        std::unordered_set<Function*> allocating;
+        bool changed = true;
+        while(changed) {
+            changed = false;
+            for(auto& F: *module) {
+                if(F.isDeclaration() || allocating.count(&F)) continue;
+                bool allocates = false;
+                for(auto& BB: F) {
+                    for(auto& I: BB) {
+                        auto call = dyn_cast<CallInst>(&I);
+                        if(!call || call->isInlineAsm()) continue;
+                        auto callee = call->getCalledFunction();
+                        if(!callee || allocating.count(callee) || (callee->isDeclaration() && callee->getName().equals("malloc"))) {
+                            allocates = true;
+                        }
+                    }
+                }
+                if(allocates) {
+                    allocating.insert(&F);
+                    changed = true;
+                }
+            }
+        }
+        size_t functions = 0;
+        frameScopedFunctions.clear();
+        for(auto& F: *module) {
+            if(F.isDeclaration()) continue;
+            functions++;
+            if(!allocating.count(&F)) {
+                frameScopedFunctions.insert(&F);
+            }
+        }
+        out.reportNote("Frame-scoped memory: " + std::to_string(frameScopedFunctions.size()) + " of "
+                       + std::to_string(functions) + " functions release their allocas on return"
+                       + (trackObjects() ? ", the others release their stack objects" : ""));
+    }
+
+    /**
+     * @brief Sets the number of processes in the model. If 0, the number is
+     * inferred from the pthread_create calls of the program.
+     */
+    void setMaxThreads(int threads) {
+        assert(threads <= MAX_PROCESSES);
+        maxThreads = threads;
+    }
+
+    /**
+     * @brief Determines the number of processes in the model, if it was not
+     * specified.
+     */
+    void determineMaxThreads() {
+        if(maxThreads > 0) {
+            out.reportAction("Using " + std::to_string(maxThreads) + " processes");
+            return;
+        }
+        ThreadCount threadCount(*module);
+        size_t inferred = threadCount.infer();
+        if(inferred > MAX_PROCESSES) {
+            maxThreads = DEFAULT_MAX_THREADS;
+            out.reportWarning("Could not infer the number of processes: "
+                             + (inferred == ThreadCount::UNBOUNDED ? threadCount.getReason()
+                                                                   : "bound of " + std::to_string(inferred) + " is too large"));
+            out.reportNote("Using " + std::to_string(maxThreads) + " processes, override with --ll2dmc.threads=N");
+        } else {
+            maxThreads = (int)inferred;
+            out.reportAction("Using " + std::to_string(maxThreads) + " processes, inferred from pthread_create calls");
+        }
+    }
+
+    /**
+     * @brief Determines the program locations from which the transition of a
+     * process is independent of all other processes. In a state where a
+     * process is at such a location, that transition alone is an ample set.
+     *
+     * A process step executes the transition group at its pc and all groups
+     * after it up to the next emitter, so the footprint of all of these is
+     * taken into account. As cycle proviso, steps that may call, return or
+     * follow a back edge of the control-flow graph are never ample. Since a
+     * cycle in the state space needs at least one of those, every cycle
+     * contains a fully expanded state. This does not depend on the order in
+     * which states are explored, so it holds for every search core.
+     */
+    void determineAmpleLocations() {
+        ampleLocations.assign(nextProgramLocation, false);
+
+        std::unordered_map<Instruction*, TransitionGroupInstructions*> groupAt;
+        for(auto t: transitionGroups) {
+            if(t->getType() != TransitionGroup::Type::Instructions) continue;
+            auto ti = static_cast<TransitionGroupInstructions*>(t);
+            if(ti->thread_id == 0) {
+                groupAt[ti->instructions.front()] = ti;
+            }
+        }
+
+        std::set<std::pair<const BasicBlock*, const BasicBlock*>> backEdges;
+        for(auto& F: *module) {
+            if(F.isDeclaration()) continue;
+            SmallVector<std::pair<const BasicBlock*, const BasicBlock*>, 8> edges;
+            FindFunctionBackedges(F, edges);
+            backEdges.insert(edges.begin(), edges.end());
+        }
+
+        FootprintAnalysis footprints(*module, escapeAnalysis.get());
+        size_t ample = 0;
+        for(auto& kv: groupAt) {
+            Instruction* start = kv.first;
+            Footprint fp;
+            bool ok = true;
+
+            // Follow the groups executed by a single step. The flag is
+            // whether an emitter has been executed already
+            std::vector<std::pair<Instruction*, bool>> todo{{start, false}};
+            std::set<std::pair<Instruction*, bool>> seen{{start, false}};
+            while(ok && !todo.empty()) {
+                Instruction* first = todo.back().first;
+                bool emitted = todo.back().second;
+                todo.pop_back();
+                auto it = groupAt.find(first);
+                if(it == groupAt.end()) {
+                    ok = false;
+                    break;
+                }
+                auto group = it->second;
+                if(group->_emitter && emitted) {
+                    continue;
+                }
+                for(auto I: group->instructions) {
+                    footprints.add(I, fp);
+                }
+                emitted |= group->_emitter;
+
+                std::vector<Instruction*> next;
+                Instruction* last = group->instructions.back();
+                if(!last->isTerminator()) {
+                    next.push_back(last->getNextNode());
+                } else if(isa<BranchInst>(last) || isa<SwitchInst>(last)) {
+                    for(auto succ: successors(last->getParent())) {
+                        if(backEdges.count({last->getParent(), succ})) {
+                            ok = false;
+                        }
+                        next.push_back(&*succ->begin());
+                    }
+                } else {
+                    ok = false;
+                }
+                for(auto I: next) {
+                    if(seen.insert({I, emitted}).second) {
+                        todo.push_back({I, emitted});
+                    }
+                }
+            }
+            if(ok && footprints.isIndependent(fp)) {
+                ampleLocations[programLocations[start]] = true;
+                ample++;
+            }
+        }
+        out.reportNote("Partial-order reduction: " + std::to_string(ample) + " of "
+                       + std::to_string(groupAt.size()) + " program locations are independent");
+    }
+
     /**
      * @brief Starts the pinsification process.
      */
@@ -377,6 +1043,12 @@ public:
         f_dmc_deltaBytes = dmcapi_inject_func("dmc_deltaB");
         f_dmc_getpart = dmcapi_inject_func("dmc_getpart");
         f_dmc_getpartBytes = dmcapi_inject_func("dmc_getpartB");
+        if(_bigChunkThreshold) {
+            f_dmc_big_insert = dmcapi_inject_func("dmc_big_insert");
+            f_dmc_big_delta = dmcapi_inject_func("dmc_big_delta");
+            f_dmc_big_get = dmcapi_inject_func("dmc_big_get");
+            f_dmc_big_getpart = dmcapi_inject_func("dmc_big_getpart");
+        }
 
         out.reportAction("Setting up LLMC OS VM Hooks");
 //        out.indent();
@@ -409,11 +1081,31 @@ public:
 //            abort();
 //        }
 
+        // Determine the number of processes the state-vector holds
+        determineMaxThreads();
+
+        if(_collapseThreadLocal) {
+            determineThreadLocalAccesses();
+        }
+
         // Determine all the transition groups from the code
         createTransitionGroups();
 
+        if(_partialOrderReduction) {
+            determineAmpleLocations();
+        }
+
         generateBasicTypes();
 
+        if(_inlineLeafFrames) {
+            determineInlineFrames();
+        }
+        determineFrameScopedFunctions();
+        determineIndirectCallTargets();
+        if(_heapSymmetry) {
+            determineAllocationSites();
+        }
+
         // Create the register mapping used to map registers to locations
         // in the state-vector
         createRegisterMapping();
@@ -421,9 +1113,20 @@ public:
         // Generate the LLVM types we need
         generateTypes();
 
+        if(_bigChunkThreshold) {
+            determineBigChunkTypes();
+        }
+
         // Initialize the stack helper functions
         stack.init();
 
+        if(trackObjects() || _threadSymmetry || _pagedMemory) {
+            generateChunkCallbacks();
+        }
+        if(_coalesceStores || _memoryView) {
+            generateMemoryCallbacks();
+        }
+
         // Generate the initial state
         generateInitialState();
 
@@ -435,6 +1138,25 @@ public:
 //        generateNextState();
 
         generateStepProcess();
+        if(_zeroDeadRegisters) {
+            out.reportNote("Dead register zeroing: " + std::to_string(zeroedRegisters) + " registers zeroed at "
+                           + std::to_string(zeroingPoints) + " transition group boundaries");
+        }
+        {
+            std::stringstream ss;
+            ss << "Call sites: " << callSites << ", of which " << inlinedFrames << " use an inlined frame and "
+               << registerFrames << " save a register frame; saving "
+               << registerFrameBytes << " of " << registerFrameBytesFull << " register bytes";
+            out.reportNote(ss.str());
+        }
+        out.reportNote("Indirect calls: " + std::to_string(indirectCalls) + ", of which "
+                       + std::to_string(indirectCallsDispatched) + " dispatched over their possible targets");
+        out.reportNote("Runtime checks: " + std::to_string(checksEmitted) + " generated, "
+                       + std::to_string(checksElided) + " elided, of which "
+                       + std::to_string(checksProven) + " proven at generation time");
+        if(_specializeStepProcess) {
+            generateSpecializedStepProcesses();
+        }
 
         generateConstructorStart();
         generateMainStart();
@@ -444,6 +1166,13 @@ public:
 
         generateDebugInfo();
 
+        // The generic step function is only there to be cloned
+        if(_specializeStepProcess) {
+            assert(f_stepProcess->use_empty());
+            f_stepProcess->eraseFromParent();
+            f_stepProcess = nullptr;
+        }
+
 
         //dmcModule->dump();
 
@@ -634,6 +1363,19 @@ public:
         return s;
     }
 
+    /**
+     * @brief The number of bytes a load or store of @c type accesses in the
+     * memory of a process. A vector accesses exactly its store size, because
+     * its allocation size may include padding, e.g. <3 x i32>, and rounding
+     * that up would overwrite the object after it.
+     */
+    Constant* generateAccessSizeOf(Type* type) {
+        if(auto vt = dyn_cast<FixedVectorType>(type)) {
+            return ConstantInt::get(t_int, dmcModule->getDataLayout().getTypeStoreSize(vt).getFixedSize());
+        }
+        return generateAlignedSizeOf(type);
+    }
+
     size_t generateSizeOfNow(Value* data) {
         return generateSizeOfNow(data->getType());
     }
@@ -718,19 +1460,13 @@ public:
 //        auto actionLabelChunkID = cm_action.generatePut(ConstantInt::get(t_int, 0), ConstantPointerNull::get(t_intp));
 //        builder.CreateStore(actionLabelChunkID, p_actionLabel);
 
-        auto cpy = builder.CreateMemCpy( svout
-                , svout->getPointerAlignment(dmcModule->getDataLayout())
-                , src
-                , src->getParamAlign()
-                , t_statevector_size
-        );
-        setDebugLocation(cpy, __FILE__, __LINE__ - 6);
-
 //        Value* gotoNext = builder.CreateAlloca(t_bool);
 //        builder.CreateStore(ConstantInt::get(t_bool, 1), gotoNext);
+        auto src_pc = lts["processes"][processorID]["pc"].getValue(src);
         auto dst_pc = lts["processes"][processorID]["pc"].getValue(svout);
 
         BasicBlock* process_active_check = BasicBlock::Create(ctx, "process_active_check" , f_stepProcess);
+        BasicBlock* process_active = BasicBlock::Create(ctx, "process_active" , f_stepProcess);
         BasicBlock* while_emitted = BasicBlock::Create(ctx, "while_emitted" , f_stepProcess);
         BasicBlock* while_notemitted = BasicBlock::Create(ctx, "while_notemitted" , f_stepProcess);
         BasicBlock* while_condition = BasicBlock::Create(ctx, "while_condition" , f_stepProcess);
@@ -739,11 +1475,54 @@ public:
         BasicBlock* nosuchpc = BasicBlock::Create(ctx, "nosuchpc" , f_stepProcess);
         BasicBlock* end_no_report = BasicBlock::Create(ctx, "end_no_report" , f_stepProcess);
 
-//        builder.CreateCall(pins("printf"), {generateGlobalString("----- getnext\n")});
-        builder.CreateBr(process_active_check);
-        builder.SetInsertPoint(process_active_check);
-        Value* pc1 = builder.CreateLoad(dst_pc);
-        builder.CreateCondBr(builder.CreateICmpNE(pc1, ConstantInt::get(t_int, 0)), while_body, end_no_report);
+//        builder.CreateCall(pins("printf"), {generateGlobalString("----- getnext\n")});
+        builder.CreateBr(process_active_check);
+        builder.SetInsertPoint(process_active_check);
+        Value* pc1 = builder.CreateLoad(src_pc);
+        builder.CreateCondBr(builder.CreateICmpNE(pc1, ConstantInt::get(t_int, 0)), process_active, end_no_report);
+
+        GenerationContext context;
+        GenerationContext* gctx = &context;
+
+        context.thread_id = processorID;
+        context.svout = svout;
+        context.src = src;
+        context.model = self;
+        context.gen = this;
+        context.alteredPC = false;
+        context.userContext = user_context;
+        context.noReportBB = end_no_report;
+        context.registers = addAlloca(t_registers_max, f_stepProcess);
+        if(_coalesceStores) {
+            auto t_storeBuffer = llmcvm_func("llmc_store_buffer_flush", true)->getFunctionType()->getParamType(2);
+            context.storeBuffer = addAlloca(t_storeBuffer->getPointerElementType(), f_stepProcess);
+        }
+        if(_memoryView) {
+            auto t_memoryView = llmcvm_func("llmc_memory_view_read", true)->getFunctionType()->getParamType(2);
+            context.memoryView = addAlloca(t_memoryView->getPointerElementType(), f_stepProcess);
+        }
+
+        // Only make the copy to work on once we know the process can step
+        builder.SetInsertPoint(process_active);
+        auto cpy = builder.CreateMemCpy( svout
+                , svout->getPointerAlignment(dmcModule->getDataLayout())
+                , src
+                , src->getParamAlign()
+                , t_statevector_size
+        );
+        setDebugLocation(cpy, __FILE__, __LINE__ - 6);
+
+        // The range of bytes of svout the step writes to, starting empty
+        AllocaInst* touchedBegin = nullptr;
+        AllocaInst* touchedEnd = nullptr;
+        if(_reportDeltas) {
+            touchedBegin = addAlloca(t_int64, f_stepProcess);
+            touchedEnd = addAlloca(t_int64, f_stepProcess);
+            builder.CreateStore(builder.CreateZExtOrTrunc(t_statevector_size, t_int64), touchedBegin);
+            builder.CreateStore(ConstantInt::get(t_int64, 0), touchedEnd);
+        }
+        generateLoadRegisters(gctx, processorID, gctx->registers);
+        builder.CreateBr(while_body);
 
         builder.SetInsertPoint(while_condition);
         auto emittedLastIteration = builder.CreatePHI(t_bool, 2);
@@ -753,10 +1532,10 @@ public:
 
         builder.SetInsertPoint(while_body);
         auto pc = builder.CreatePHI(t_int, 2);
-        pc->addIncoming(pc1, process_active_check);
+        pc->addIncoming(pc1, process_active);
         pc->addIncoming(pc2, while_condition);
         auto emitted = builder.CreatePHI(t_bool, 2);
-        emitted->addIncoming(ConstantInt::get(t_bool, 0), process_active_check);
+        emitted->addIncoming(ConstantInt::get(t_bool, 0), process_active);
         emitted->addIncoming(emittedLastIteration, while_condition);
 //        builder.CreateCall(pins("printf"), {generateGlobalString("STEP processorID %u, pc %u\n"), processorID, pc});
         SwitchInst* swtch = builder.CreateSwitch(pc, nosuchpc, transitionGroups.size());
@@ -764,18 +1543,6 @@ public:
         emittedLastIteration->addIncoming(ConstantInt::get(t_bool, 1), while_emitted);
         emittedLastIteration->addIncoming(emitted, while_notemitted);
 
-        GenerationContext context;
-        GenerationContext* gctx = &context;
-
-        context.thread_id = processorID;
-        context.svout = svout;
-        context.src = src;
-        context.model = self;
-        context.gen = this;
-        context.alteredPC = false;
-        context.userContext = user_context;
-        context.noReportBB = end_no_report;
-
         builder.SetInsertPoint(while_emitted);
         builder.CreateBr(while_condition);
         builder.SetInsertPoint(while_notemitted);
@@ -838,12 +1605,184 @@ public:
 //        }
 
 //        builder.CreateCall(pins("printf"), {generateGlobalString("Emitting PC: %u\n"), builder.CreateLoad(dst_pc)});
+        if(_heapSymmetry) {
+            generateCanonicalizeHeap(gctx, processorID);
+        }
+        generateStoreRegisters(gctx, processorID, gctx->registers);
+        if(_heapGC) {
+            generateCollectGarbage(gctx, processorID);
+        }
+        if(_threadSymmetry) {
+            generateCanonicalizeThreads(gctx);
+        }
         StateManager sm_root(user_context, this, lts.getSV().getType());
-        sm_root.uploadBytes(stateID, svout, t_statevector_size);
+        if(_reportDeltas) {
+
+            // Report only the range of the root that the step changed,
+            // relative to the source state. Only the words the step wrote
+            // to are compared against the source state.
+            generateTouchedRangeTracking(f_stepProcess, svout, cpy, touchedBegin, touchedEnd);
+            Value* begin = builder.CreateLoad(t_int64, touchedBegin);
+            Value* end = builder.CreateLoad(t_int64, touchedEnd);
+
+            // A step always writes its pc, but if nothing was written the
+            // delta is still a valid one of a single word
+            Value* nothingWritten = builder.CreateICmpUGE(begin, end);
+            begin = builder.CreateSelect(nothingWritten, ConstantInt::get(t_int64, 0), begin);
+            end = builder.CreateSelect(nothingWritten, ConstantInt::get(t_int64, 4), end);
+
+            Value* words = builder.CreateUDiv(builder.CreateZExtOrTrunc(t_statevector_size, t_int64), ConstantInt::get(t_int64, 4));
+            Value* beginWord = builder.CreateUDiv(begin, ConstantInt::get(t_int64, 4));
+            Value* endWord = builder.CreateUDiv(builder.CreateAdd(end, ConstantInt::get(t_int64, 3)), ConstantInt::get(t_int64, 4));
+            endWord = builder.CreateSelect(builder.CreateICmpULT(endWord, words), endWord, words);
+            Value* beginOffset = builder.CreateMul(beginWord, ConstantInt::get(t_int64, 4));
+
+            auto first = addAlloca(t_int64, f_stepProcess);
+            auto last = addAlloca(t_int64, f_stepProcess);
+            auto f_diff = llmcvm_func("llmc_diff_range", true);
+            auto t_diff = f_diff->getFunctionType();
+            builder.CreateCall(f_diff, { builder.CreatePointerCast(builder.CreateGEP(t_char, builder.CreatePointerCast(src, t_charp), beginOffset), t_diff->getParamType(0))
+                                       , builder.CreatePointerCast(builder.CreateGEP(t_char, builder.CreatePointerCast(svout, t_charp), beginOffset), t_diff->getParamType(1))
+                                       , builder.CreateIntCast(builder.CreateSub(endWord, beginWord), t_diff->getParamType(2), false)
+                                       , builder.CreatePointerCast(first, t_diff->getParamType(3))
+                                       , builder.CreatePointerCast(last, t_diff->getParamType(4))
+                                       });
+            Value* firstWord = builder.CreateAdd(beginWord, builder.CreateLoad(t_int64, first));
+            Value* lastWord = builder.CreateAdd(beginWord, builder.CreateLoad(t_int64, last));
+            Value* offset = builder.CreateMul(firstWord, ConstantInt::get(t_int64, 4));
+            Value* length = builder.CreateMul(builder.CreateSub(lastWord, firstWord), ConstantInt::get(t_int64, 4));
+            Value* data = builder.CreateGEP(t_char, builder.CreatePointerCast(svout, t_charp), offset);
+            sm_root.deltaBytes(stateID, offset, length, data);
+        } else {
+            sm_root.uploadBytes(stateID, svout, t_statevector_size);
+        }
         builder.CreateRet(ConstantInt::get(t_int64, 1));
 
     }
 
+    /**
+     * @brief Instruments every write to @c sv in @c f, such that
+     * [*touchedBegin, *touchedEnd) covers all bytes of @c sv the function
+     * wrote to when it reaches its end. Stores widen the range by the bytes
+     * they store and memory intrinsics by the bytes they write. A call that
+     * receives a pointer into @c sv, such as to the VM, may write anywhere
+     * in it, so it widens the range to the complete state-vector, as does
+     * a pointer into @c sv that is itself stored to memory.
+     * @param f The function to instrument, before the code using the range
+     * is added to it
+     * @param sv The state-vector written to by @c f
+     * @param skip The copy of the source state to @c sv, which is not a
+     * change
+     * @param touchedBegin i64* to the first byte offset written to
+     * @param touchedEnd i64* to one past the last byte offset written to
+     */
+    void generateTouchedRangeTracking(Function* f, Argument* sv, Instruction* skip, Value* touchedBegin, Value* touchedEnd) {
+        auto& DL = dmcModule->getDataLayout();
+        auto pointsIntoSV = [sv](Value* pointer) {
+            if(!pointer->getType()->isPointerTy()) {
+                return false;
+            }
+            SmallVector<const Value*, 4> objects;
+            getUnderlyingObjects(pointer, objects, nullptr, 0);
+            for(auto object: objects) {
+                if(object == sv) {
+                    return true;
+                }
+            }
+            return false;
+        };
+
+        // Collect the writes first, since instrumenting adds instructions
+        struct Write {
+            Instruction* at;
+            Value* pointer;
+            Value* length;
+        };
+        std::vector<Write> writes;
+        auto storeSize = [&](Value* value) {
+            return ConstantInt::get(t_int64, DL.getTypeStoreSize(value->getType()).getFixedSize());
+        };
+        std::vector<Instruction*> writesAnywhere;
+        for(auto& bb: *f) {
+            for(auto& I: bb) {
+                if(&I == skip || isa<DbgInfoIntrinsic>(&I)) {
+                    continue;
+                }
+                if(auto store = dyn_cast<StoreInst>(&I)) {
+                    if(pointsIntoSV(store->getValueOperand())) {
+                        writesAnywhere.push_back(&I);
+                    } else if(pointsIntoSV(store->getPointerOperand())) {
+                        writes.push_back({&I, store->getPointerOperand(), storeSize(store->getValueOperand())});
+                    }
+                } else if(auto rmw = dyn_cast<AtomicRMWInst>(&I)) {
+                    if(pointsIntoSV(rmw->getPointerOperand())) {
+                        writes.push_back({&I, rmw->getPointerOperand(), storeSize(rmw->getValOperand())});
+                    }
+                } else if(auto cmpxchg = dyn_cast<AtomicCmpXchgInst>(&I)) {
+                    if(pointsIntoSV(cmpxchg->getPointerOperand())) {
+                        writes.push_back({&I, cmpxchg->getPointerOperand(), storeSize(cmpxchg->getNewValOperand())});
+                    }
+                } else if(auto mi = dyn_cast<MemIntrinsic>(&I)) {
+                    if(pointsIntoSV(mi->getRawDest())) {
+                        writes.push_back({&I, mi->getRawDest(), mi->getLength()});
+                    }
+                } else if(auto call = dyn_cast<CallBase>(&I)) {
+                    for(auto& arg: call->args()) {
+                        if(pointsIntoSV(arg.get())) {
+                            writesAnywhere.push_back(&I);
+                            break;
+                        }
+                    }
+                }
+            }
+        }
+
+        IRBuilder<>::InsertPointGuard guard(builder);
+        auto widen = [&](Value* from, Value* to) {
+            Value* begin = builder.CreateLoad(t_int64, touchedBegin);
+            Value* end = builder.CreateLoad(t_int64, touchedEnd);
+            builder.CreateStore(builder.CreateSelect(builder.CreateICmpULT(from, begin), from, begin), touchedBegin);
+            builder.CreateStore(builder.CreateSelect(builder.CreateICmpUGT(to, end), to, end), touchedEnd);
+        };
+        auto offsetOf = [&](Value* pointer) {
+            return builder.CreateSub( builder.CreatePtrToInt(pointer, t_int64)
+                                    , builder.CreatePtrToInt(sv, t_int64)
+                                    );
+        };
+        for(auto& w: writes) {
+            builder.SetInsertPoint(w.at);
+            Value* from = offsetOf(w.pointer);
+            widen(from, builder.CreateAdd(from, builder.CreateZExtOrTrunc(w.length, t_int64)));
+        }
+        for(auto& w: writesAnywhere) {
+            builder.SetInsertPoint(w);
+            widen(ConstantInt::get(t_int64, 0), builder.CreateZExtOrTrunc(t_statevector_size, t_int64));
+        }
+    }
+
+    /**
+     * @brief Clones model_step once per process, with the processor ID
+     * argument replaced by the constant ID of that process. This allows
+     * the offsets into the state-vector to be folded at compile time.
+     */
+    void generateSpecializedStepProcesses() {
+        f_stepProcessSpecialized.clear();
+        Argument* processorID = &*std::next(f_stepProcess->arg_begin());
+        for(int i = 0; i < maxThreads; ++i) {
+            ValueToValueMapTy VMap;
+            VMap[processorID] = ConstantInt::get(t_int, i);
+            Function* clone = CloneFunction(f_stepProcess, VMap);
+            clone->setName("model_step_" + std::to_string(i));
+            clone->setLinkage(GlobalValue::LinkageTypes::InternalLinkage);
+            f_stepProcessSpecialized.push_back(clone);
+        }
+        std::stringstream ss;
+        ss << "Specialized model_step for " << maxThreads << " processes ("
+           << f_stepProcess->getInstructionCount() << " instructions each, "
+           << f_stepProcess->getInstructionCount() * maxThreads << " in total)";
+        out.reportNote(ss.str());
+    }
+
     bool generateNextStateForGroup(TransitionGroupInstructions* ti, GenerationContext* gctx, BasicBlock* noReportBB, Function* func) {
 
         auto dst_pc = lts["processes"][gctx->thread_id]["pc"].getValue(gctx->svout);
@@ -888,6 +1827,15 @@ public:
                 strout << *I;
                 emitter = true;
             }
+
+            // Only loads and stores use the store buffer; instructions that
+            // may access memory in another way see the chunk after a flush
+            if(gctx->storeBuffer) {
+                gctx->bufferStores = isa<LoadInst>(I) || isa<StoreInst>(I);
+                if(!gctx->bufferStores && !isTransparentToStoreBuffer(I)) {
+                    generateFlushStores(gctx);
+                }
+            }
             generateNextStateForInstruction(gctx, I);
 
 //            std::string sInstruction;
@@ -914,11 +1862,22 @@ public:
         strout << "   ";
         strout.flush();
 
+        if(gctx->storeBuffer) {
+            gctx->bufferStores = false;
+            generateFlushStores(gctx);
+        }
+
         // Generate the next state for all other actions
         for(auto& action: ti->actions) {
             generateNextStateForInstruction(gctx, action);
         }
 
+        // Branches and calls handle the registers at their destination
+        Instruction* last = ti->instructions.back();
+        if(_zeroDeadRegisters && !last->isTerminator() && !pushesStackFrame(last)) {
+            generateZeroingOfDeadRegisters(gctx, last->getNextNode());
+        }
+
         // Generate the action label
         if(emitter) {
             // TODO: dmc api needs this
@@ -1001,6 +1960,50 @@ public:
 
     }
 
+    /**
+     * @brief Generates the selection of an ample set in dmc_nextstates: the
+     * first process at an independent program location is stepped on its
+     * own. If it does not emit a successor, all processes are explored.
+     */
+    void generateAmpleSelection(Value* user_context, Value* stateID, Value* src, Value* svout) {
+        std::vector<Constant*> entries;
+        for(bool isAmple: ampleLocations) {
+            entries.push_back(ConstantInt::get(t_char, isAmple));
+        }
+        auto t_table = ArrayType::get(t_char, entries.size());
+        auto table = new GlobalVariable( *dmcModule
+                                       , t_table
+                                       , true
+                                       , GlobalValue::LinkageTypes::InternalLinkage
+                                       , ConstantArray::get(t_table, entries)
+                                       , "llmc_ample_locations"
+                                       );
+
+        for(size_t p = 0; p < (size_t)maxThreads; ++p) {
+            BasicBlock* ample_step = BasicBlock::Create(ctx, "ample_step" , f_dmc_nextstates);
+            BasicBlock* ample_emitted = BasicBlock::Create(ctx, "ample_emitted" , f_dmc_nextstates);
+            BasicBlock* ample_next = BasicBlock::Create(ctx, "ample_next" , f_dmc_nextstates);
+
+            Value* pc = builder.CreateLoad(t_int, lts["processes"][p]["pc"].getValue(src), "pc");
+            Value* isAmple = builder.CreateLoad(t_char, builder.CreateGEP(t_table, table, {ConstantInt::get(t_int, 0), pc}));
+            builder.CreateCondBr(builder.CreateICmpNE(isAmple, ConstantInt::get(t_char, 0)), ample_step, ample_next);
+
+            builder.SetInsertPoint(ample_step);
+            Value* emitted;
+            if(_specializeStepProcess) {
+                emitted = builder.CreateCall(f_stepProcessSpecialized[p], {user_context, stateID, src, svout});
+            } else {
+                emitted = builder.CreateCall(f_stepProcess, {user_context, ConstantInt::get(t_int, p), stateID, src, svout});
+            }
+            builder.CreateCondBr(builder.CreateICmpNE(emitted, ConstantInt::get(t_int64, 0)), ample_emitted, ample_next);
+
+            builder.SetInsertPoint(ample_emitted);
+            builder.CreateRet(emitted);
+
+            builder.SetInsertPoint(ample_next);
+        }
+    }
+
     void generateGetNextAllDMC() {
         f_dmc_nextstates = Function::Create( t_dmc_nextstates
                 , GlobalValue::LinkageTypes::ExternalLinkage
@@ -1020,9 +2023,6 @@ public:
         BasicBlock* constructors_start  = BasicBlock::Create(ctx, "constructors_start" , f_dmc_nextstates);
         BasicBlock* main_start  = BasicBlock::Create(ctx, "main_start" , f_dmc_nextstates);
         BasicBlock* process_loop  = BasicBlock::Create(ctx, "process_loop" , f_dmc_nextstates);
-        BasicBlock* forcond = BasicBlock::Create(ctx, "for_cond" , f_dmc_nextstates);
-        BasicBlock* forbody = BasicBlock::Create(ctx, "for_body" , f_dmc_nextstates);
-        BasicBlock* forincr = BasicBlock::Create(ctx, "for_incr" , f_dmc_nextstates);
         BasicBlock* incrstatusifneeded = BasicBlock::Create(ctx, "incrstatusifneeded" , f_dmc_nextstates);
         BasicBlock* incrstatus = BasicBlock::Create(ctx, "incrstatus" , f_dmc_nextstates);
         BasicBlock* wrongstatus = BasicBlock::Create(ctx, "wrongstatus" , f_dmc_nextstates);
@@ -1082,36 +2082,56 @@ public:
 
         // Process loop
         builder.SetInsertPoint(process_loop);
+        if(_partialOrderReduction) {
+            generateAmpleSelection(user_context, stateID, src, svout);
+        }
 //        builder.CreateCall( pins("printf")
 //                , { generateGlobalString("process_loop: %u\n")
 //                                    , status
 //                            }
 //        );
-        builder.CreateBr(forcond);
-
-        // The condition checks that the current processorID is
-        // smaller than the total number of processors
-        builder.SetInsertPoint(forcond);
-        PHINode* tg = builder.CreatePHI(t_int, 2, "ProcessorID");
-        PHINode* emitted = builder.CreatePHI(t_int64, 2, "emitted");
-        Value* cond = builder.CreateICmpULT(tg, ConstantInt::get(t_int, MAX_THREADS));
-        builder.CreateCondBr(cond, forbody, incrstatusifneeded);
-
-        // The body of the for loop: calls pins_getnext for very processorID
-        builder.SetInsertPoint(forbody);
-        Value* emittedByProcessStep = builder.CreateCall(f_stepProcess, {user_context, tg, stateID, src, svout});
-        builder.CreateBr(forincr);
-
-        // Increment tg
-        builder.SetInsertPoint(forincr);
-        Value* nextP = builder.CreateAdd(tg, ConstantInt::get(t_int, 1));
-
-        // Tell the Phi node of the incoming edges
-        tg->addIncoming(ConstantInt::get(t_int, 0), process_loop);
-        tg->addIncoming(nextP, forincr);
-        emitted->addIncoming(ConstantInt::get(t_int64, 0), process_loop);
-        emitted->addIncoming(builder.CreateAdd(emittedByProcessStep, emitted), forincr);
-        builder.CreateBr(forcond);
+        Value* emitted = nullptr;
+        if(_specializeStepProcess) {
+
+            // Call the step function of every process directly
+            emitted = ConstantInt::get(t_int64, 0);
+            for(auto stepProcess: f_stepProcessSpecialized) {
+                Value* emittedByProcessStep = builder.CreateCall(stepProcess, {user_context, stateID, src, svout});
+                emitted = builder.CreateAdd(emittedByProcessStep, emitted);
+            }
+            builder.CreateBr(incrstatusifneeded);
+        } else {
+            BasicBlock* forcond = BasicBlock::Create(ctx, "for_cond" , f_dmc_nextstates);
+            BasicBlock* forbody = BasicBlock::Create(ctx, "for_body" , f_dmc_nextstates);
+            BasicBlock* forincr = BasicBlock::Create(ctx, "for_incr" , f_dmc_nextstates);
+            BasicBlock* forentry = builder.GetInsertBlock();
+            builder.CreateBr(forcond);
+
+            // The condition checks that the current processorID is
+            // smaller than the total number of processors
+            builder.SetInsertPoint(forcond);
+            PHINode* tg = builder.CreatePHI(t_int, 2, "ProcessorID");
+            PHINode* emittedPHI = builder.CreatePHI(t_int64, 2, "emitted");
+            Value* cond = builder.CreateICmpULT(tg, ConstantInt::get(t_int, maxThreads));
+            builder.CreateCondBr(cond, forbody, incrstatusifneeded);
+
+            // The body of the for loop: calls pins_getnext for very processorID
+            builder.SetInsertPoint(forbody);
+            Value* emittedByProcessStep = builder.CreateCall(f_stepProcess, {user_context, tg, stateID, src, svout});
+            builder.CreateBr(forincr);
+
+            // Increment tg
+            builder.SetInsertPoint(forincr);
+            Value* nextP = builder.CreateAdd(tg, ConstantInt::get(t_int, 1));
+
+            // Tell the Phi node of the incoming edges
+            tg->addIncoming(ConstantInt::get(t_int, 0), forentry);
+            tg->addIncoming(nextP, forincr);
+            emittedPHI->addIncoming(ConstantInt::get(t_int64, 0), forentry);
+            emittedPHI->addIncoming(builder.CreateAdd(emittedByProcessStep, emittedPHI), forincr);
+            builder.CreateBr(forcond);
+            emitted = emittedPHI;
+        }
 
         builder.SetInsertPoint(incrstatusifneeded);
         builder.CreateCondBr(builder.CreateICmpEQ(ConstantInt::get(t_int64, 0), emitted), incrstatus, end);
@@ -1265,9 +2285,13 @@ public:
                 assert(0);
             }
             auto bitsNeeded = DL.getTypeSizeInBits(kv.second.registerLayout);
+            kv.second.registerSize = (DL.getTypeAllocSize(kv.second.registerLayout) + 3) & ~(size_t)3;
 //            std::stringstream ss;
 //            ss << kv.first->getName().str() << " needs " << (bitsNeeded / 8) << " bytes";
 //            out.reportNote(ss.str());
+            if(inlineFrameFunctions.count(kv.first)) {
+                continue;
+            }
             if(registersInBits < bitsNeeded) {
                 registersInBits = bitsNeeded;
             }
@@ -1279,6 +2303,15 @@ public:
 //            maxSize = builder.CreateSelect(cond, newSize, maxSize);
 
         }
+
+        // Inlined frames are placed after the registers of any caller
+        inlineFrameOffset = ((registersInBits / 8) + 7) & ~(size_t)7;
+        for(auto F: inlineFrameFunctions) {
+            size_t bitsNeeded = (inlineFrameOffset + registerLayout[F].registerSize) * 8;
+            if(registersInBits < bitsNeeded) {
+                registersInBits = bitsNeeded;
+            }
+        }
         out.outdent();
 //        t_registers_max_size = maxSize;
         t_registers_max = ArrayType::get(t_int, registersInBits / 32); // needs to be based on max #registers of all functions
@@ -1290,6 +2323,10 @@ public:
         ss << "Determined required number of registers: " << (registersInBits / 32) << " slots";
         out.reportAction(ss.str());
 
+        // The registers of a process are stored in a separate chunk, only as
+        // large as the register layout of the function it is executing
+        generateRegisterSizes();
+
         t_registers_max_size = builder.CreatePtrToInt(t_registers_max_size, t_int);
 
         // Creates types to use in the LTS type
@@ -1305,7 +2342,7 @@ public:
         );
         type_register_frame = typeManager.newType("rframe", t_chunkid
         );
-        type_registers = typeManager.newType("register", t_registers_max
+        type_registers = typeManager.newType("register", t_chunkid
         );
         type_memory = typeManager.newType("memory", t_chunkid
         );
@@ -1360,7 +2397,7 @@ public:
                     ;
 //            *sv_processes << sv_proc;
 //        }
-        auto sv_processes = SVTree::newArray("processes", "processes", sv_proc, MAX_THREADS);
+        auto sv_processes = SVTree::newArray("processes", "processes", sv_proc, maxThreads);
 
         // Types
         auto structTypes = module->getIdentifiedStructTypes();
@@ -1394,7 +2431,11 @@ public:
             valueRegisterIndex[&t] = nextID++;
             globals.push_back(t.getType()->getPointerElementType());
         }
-        t_globals = StructType::get(ctx, globals, true);
+
+        // Not packed and 8-aligned, so pointers in the globals and the heap
+        // objects after them are at 8-aligned offsets in the memory
+        globals.push_back(ArrayType::get(t_int64, 0));
+        t_globals = StructType::get(ctx, globals, false);
 
         for(auto& t: module->getGlobalList()) {
             if(t.hasInitializer()) {
@@ -1499,19 +2540,562 @@ public:
                                         , false
         );
 
-        t_stepProcess = FunctionType::get( t_int64
-                                         , { t_voidp
-                                           , t_int
-                                           , t_int64
-                                           , PointerType::get(t_statevector, 0)
-                                           , PointerType::get(t_statevector, 0)
-                                           }
-                                         , false
-        );
+        t_stepProcess = FunctionType::get( t_int64
+                                         , { t_voidp
+                                           , t_int
+                                           , t_int64
+                                           , PointerType::get(t_statevector, 0)
+                                           , PointerType::get(t_statevector, 0)
+                                           }
+                                         , false
+        );
+
+        // Get the size of the SV
+        t_statevector_size = generateAlignedSizeOf(t_statevector);
+        assert(t_statevector_size);
+    }
+
+    /**
+     * @brief Determines the register size of every function and generates
+     * the table llmc_register_sizes, which maps every program location to
+     * the register size of the function it is in. Location 0, a terminated
+     * process, has no registers.
+     */
+    void generateRegisterSizes() {
+        size_t maxSize = 0;
+        size_t functions = 0;
+        size_t totalSize = 0;
+        for(auto& kv: registerLayout) {
+            maxSize = std::max(maxSize, getRegisterAreaSize(kv.first));
+            totalSize += getRegisterAreaSize(kv.first);
+            functions++;
+        }
+
+        std::vector<Constant*> entries(nextProgramLocation, ConstantInt::get(t_int, 0));
+        for(auto& kv: programLocations) {
+            if(!kv.first) continue;
+            auto F = kv.first->getFunction();
+            if(!registerLayout.count(F)) continue;
+            entries[kv.second] = ConstantInt::get(t_int, getRegisterAreaSize(F));
+        }
+        auto t_table = ArrayType::get(t_int, entries.size());
+        g_registerSizes = new GlobalVariable( *dmcModule
+                                            , t_table
+                                            , true
+                                            , GlobalValue::LinkageTypes::InternalLinkage
+                                            , ConstantArray::get(t_table, entries)
+                                            , "llmc_register_sizes"
+                                            );
+
+        std::stringstream ss;
+        ss << "Registers stored per function: " << (functions ? totalSize / functions : 0) << " bytes on average, "
+           << maxSize << " bytes at most, instead of " << maxSize << " bytes in every process of the root";
+        out.reportNote(ss.str());
+    }
+
+    /**
+     * @brief Adds the offsets of the pointers in a value of type @c type at
+     * @c offset to @c offsets.
+     */
+    void collectPointerOffsets(Type* type, uint64_t offset, std::vector<uint32_t>& offsets) {
+        auto& DL = dmcModule->getDataLayout();
+        if(type->isPointerTy()) {
+            offsets.push_back(offset);
+        } else if(auto st = dyn_cast<StructType>(type)) {
+            auto layout = DL.getStructLayout(st);
+            for(unsigned idx = 0; idx < st->getNumElements(); ++idx) {
+                collectPointerOffsets(st->getElementType(idx), offset + layout->getElementOffset(idx), offsets);
+            }
+        } else if(auto at = dyn_cast<ArrayType>(type)) {
+            collectPointerOffsets(at->getElementType(), at->getNumElements(), DL.getTypeAllocSize(at->getElementType()), offset, offsets);
+        } else if(auto vt = dyn_cast<FixedVectorType>(type)) {
+            collectPointerOffsets(vt->getElementType(), vt->getNumElements(), DL.getTypeSizeInBits(vt->getElementType()) / 8, offset, offsets);
+        }
+    }
+
+    /**
+     * @brief Adds the offsets of the pointers in @c count elements of type
+     * @c type, @c stride bytes apart, at @c offset to @c offsets.
+     */
+    void collectPointerOffsets(Type* type, uint64_t count, uint64_t stride, uint64_t offset, std::vector<uint32_t>& offsets) {
+        std::vector<uint32_t> element;
+        collectPointerOffsets(type, 0, element);
+        for(uint64_t i = 0; i < count && !element.empty(); ++i) {
+            for(auto o: element) {
+                offsets.push_back(offset + i * stride + o);
+            }
+        }
+    }
+
+    /**
+     * @brief Generates the tables of the offsets of the pointers in the
+     * globals and the registers, see g_globalPointers, and in the objects
+     * of every allocation site, see g_sitePointers. The registers of the
+     * caller of an inlined frame are not known, so pointers in them are
+     * not either.
+     */
+    void generatePointerSlotTables() {
+        auto makeTable = [this](std::vector<uint32_t> const& values, const char* name) {
+            std::vector<Constant*> entries;
+            for(auto v: values) {
+                entries.push_back(ConstantInt::get(t_int, v));
+            }
+            auto t_table = ArrayType::get(t_int, entries.size());
+            return new GlobalVariable( *dmcModule
+                                     , t_table
+                                     , true
+                                     , GlobalValue::LinkageTypes::InternalLinkage
+                                     , ConstantArray::get(t_table, entries)
+                                     , name
+                                     );
+        };
+
+        std::vector<uint32_t> globalPointers;
+        collectPointerOffsets(t_globals, 0, globalPointers);
+        globalPointerCount = globalPointers.size();
+        g_globalPointers = makeTable(globalPointers, "llmc_global_pointers");
+
+        std::vector<uint32_t> registerPointers;
+        std::unordered_map<Function*, std::pair<uint32_t, uint32_t>> functionPointers;
+        for(auto& kv: registerLayout) {
+            auto start = registerPointers.size();
+            auto base = inlineFrameFunctions.count(kv.first) ? inlineFrameOffset : 0;
+            collectPointerOffsets(kv.second.registerLayout, base, registerPointers);
+            functionPointers[kv.first] = {(uint32_t)start, (uint32_t)(registerPointers.size() - start)};
+        }
+        g_registerPointers = makeTable(registerPointers, "llmc_register_pointers");
+
+        std::vector<uint32_t> starts(nextProgramLocation, 0);
+        std::vector<uint32_t> counts(nextProgramLocation, 0);
+        for(auto& kv: programLocations) {
+            if(!kv.first) continue;
+            auto it = functionPointers.find(kv.first->getFunction());
+            if(it == functionPointers.end()) continue;
+            starts[kv.second] = it->second.first;
+            counts[kv.second] = it->second.second;
+        }
+        g_registerPointerStart = makeTable(starts, "llmc_register_pointer_start");
+        g_registerPointerCount = makeTable(counts, "llmc_register_pointer_count");
+
+        auto& DL = dmcModule->getDataLayout();
+        std::vector<uint32_t> sitePointers;
+        std::vector<uint32_t> siteStarts;
+        std::vector<uint32_t> siteCounts;
+        std::vector<uint32_t> siteStrides;
+        for(auto type: allocationSiteTypes) {
+            auto start = sitePointers.size();
+            if(type) {
+                collectPointerOffsets(type, 0, sitePointers);
+            }
+            siteStarts.push_back(start);
+            siteCounts.push_back(sitePointers.size() - start);
+            siteStrides.push_back(type ? DL.getTypeAllocSize(type) : 0);
+        }
+        g_sitePointers = makeTable(sitePointers, "llmc_site_pointers");
+        g_sitePointerStart = makeTable(siteStarts, "llmc_site_pointer_start");
+        g_sitePointerCount = makeTable(siteCounts, "llmc_site_pointer_count");
+        g_siteStride = makeTable(siteStrides, "llmc_site_stride");
+    }
+
+    /**
+     * @brief The number of bytes of the register area of a process while it
+     * executes @c F. For an inlined frame, this includes the registers of
+     * the caller.
+     */
+    size_t getRegisterAreaSize(Function* F) {
+        auto size = registerLayout[F].registerSize;
+        return inlineFrameFunctions.count(F) ? inlineFrameOffset + size : size;
+    }
+
+    /**
+     * @brief Determines which chunk types are stored using the dmc_big_*
+     * API. Chunk IDs of the two APIs cannot be told apart, so the choice is
+     * made per type, using the smallest chunk that type can have that is
+     * known statically: memory always starts with the globals and the
+     * registers and register frames are as large as the register area of
+     * the largest function. The VM callbacks llmc_vm_get() and
+     * llmc_vm_put() handle chunks of all types, so when they are used, the
+     * dmc_big_* API is not.
+     *
+     * The length of a chunk of the dmc_big_* API is not known to be encoded
+     * in the upper bits of its ID like that of the regular API, so
+     * getLengthOfStateID() and StateManager::getLength() are not used on
+     * big chunks. The memory view relies on it, so memory is then not big.
+     */
+    void determineBigChunkTypes() {
+        if(trackObjects() || _threadSymmetry || _pagedMemory) {
+            out.reportNote("Big chunks: not used together with the VM callbacks of heap_gc, heap_symmetry, thread_symmetry or paged_memory");
+            return;
+        }
+        auto& DL = dmcModule->getDataLayout();
+        size_t globalsSize = DL.getTypeAllocSize(t_globals);
+        size_t registersSize = 0;
+        for(auto& kv: registerLayout) {
+            registersSize = std::max(registersSize, getRegisterAreaSize(kv.first));
+        }
+        if(globalsSize >= _bigChunkThreshold && !_memoryView) {
+            bigChunkTypes.insert(type_memory);
+        }
+        if(registersSize >= _bigChunkThreshold) {
+            bigChunkTypes.insert(type_registers);
+            bigChunkTypes.insert(type_register_frame);
+        }
+        std::stringstream ss;
+        ss << "Big chunks (" << _bigChunkThreshold << " bytes or larger): memory "
+           << (isBigChunkType(type_memory) ? "yes" : "no") << " (" << globalsSize << " bytes of globals), registers "
+           << (isBigChunkType(type_registers) ? "yes" : "no") << " (" << registersSize << " bytes at most)";
+        out.reportNote(ss.str());
+    }
+
+    /**
+     * @brief Generates the download of the registers of process @c threadID
+     * into @c registers. Registers beyond the stored chunk are 0.
+     */
+    void generateLoadRegisters(GenerationContext* gctx, Value* threadID, Value* registers) {
+        builder.CreateMemSet( registers
+                            , ConstantInt::get(t_int8, 0)
+                            , t_registers_max_size
+                            , registers->getPointerAlignment(dmcModule->getDataLayout())
+                            );
+        auto chunkID = builder.CreateLoad(t_chunkid, lts["processes"][threadID]["r"].getValue(gctx->svout), "registersChunkID");
+        llvmgen::If If(builder, "if_registers_stored");
+        If.setCond(builder.CreateICmpNE(chunkID, ConstantInt::get(t_chunkid, 0)));
+        BasicBlock* BBTrue = If.getTrue();
+        If.generate();
+        auto BBEnd = builder.GetInsertBlock();
+        builder.SetInsertPoint(&*BBTrue->getFirstInsertionPt());
+        StateManager sm_registers(gctx->userContext, this, type_registers);
+        sm_registers.download(chunkID, registers);
+        builder.SetInsertPoint(BBEnd);
+    }
+
+    /**
+     * @brief Generates the upload of @c registers as the registers of
+     * process @c threadID, sized by the function at the PC of that process.
+     * A process without registers stores chunk ID 0.
+     */
+    void generateStoreRegisters(GenerationContext* gctx, Value* threadID, Value* registers) {
+        auto pChunkID = lts["processes"][threadID]["r"].getValue(gctx->svout);
+        auto pc = builder.CreateLoad(t_int, lts["processes"][threadID]["pc"].getValue(gctx->svout), "pc");
+        auto t_table = g_registerSizes->getValueType();
+        auto size = builder.CreateLoad(t_int, builder.CreateGEP(t_table, g_registerSizes, {ConstantInt::get(t_int, 0), pc}), "registersSize");
+        builder.CreateStore(ConstantInt::get(t_chunkid, 0), pChunkID);
+        llvmgen::If If(builder, "if_registers_used");
+        If.setCond(builder.CreateICmpNE(size, ConstantInt::get(t_int, 0)));
+        BasicBlock* BBTrue = If.getTrue();
+        If.generate();
+        auto BBEnd = builder.GetInsertBlock();
+        builder.SetInsertPoint(&*BBTrue->getFirstInsertionPt());
+        StateManager sm_registers(gctx->userContext, this, type_registers);
+        builder.CreateStore(sm_registers.uploadBytes(registers, size), pChunkID);
+        builder.SetInsertPoint(BBEnd);
+    }
+
+    /**
+     * @brief Generates the callbacks the VM uses to access chunks:
+     * llmc_vm_get(userContext, chunkID, data) downloads a chunk and
+     * llmc_vm_put(userContext, data, length) uploads one.
+     */
+    void generateChunkCallbacks() {
+        IRBuilder<>::InsertPointGuard guard(builder);
+        {
+            auto t_get = FunctionType::get(t_void, {t_voidp, t_chunkid, t_voidp}, false);
+            f_vmGetChunk = Function::Create(t_get, GlobalValue::LinkageTypes::InternalLinkage, "llmc_vm_get", dmcModule);
+            auto args = f_vmGetChunk->arg_begin();
+            Argument* userContext = &*args++;
+            Argument* chunkID = &*args++;
+            Argument* data = &*args++;
+            builder.SetInsertPoint(BasicBlock::Create(ctx, "entry", f_vmGetChunk));
+            StateManager sm(userContext, this, type_memory);
+            sm.download(chunkID, data);
+            builder.CreateRetVoid();
+        }
+        {
+            auto t_put = FunctionType::get(t_chunkid, {t_voidp, t_voidp, t_int64}, false);
+            f_vmPutChunk = Function::Create(t_put, GlobalValue::LinkageTypes::InternalLinkage, "llmc_vm_put", dmcModule);
+            auto args = f_vmPutChunk->arg_begin();
+            Argument* userContext = &*args++;
+            Argument* data = &*args++;
+            Argument* length = &*args++;
+            builder.SetInsertPoint(BasicBlock::Create(ctx, "entry", f_vmPutChunk));
+            StateManager sm(userContext, this, type_memory);
+            builder.CreateRet(builder.CreateIntCast(sm.uploadBytes(data, length), t_chunkid, false));
+        }
+    }
+
+    /**
+     * @brief Generates the callbacks the store buffer of the VM uses to
+     * access memory: llmc_vm_read(userContext, pChunkMemory, offset, length,
+     * data) and llmc_vm_write(userContext, pChunkMemory, offset, length,
+     * data), where @c pChunkMemory points to the chunk ID of the memory in
+     * the state-vector.
+     */
+    void generateMemoryCallbacks() {
+        IRBuilder<>::InsertPointGuard guard(builder);
+        auto t_access = FunctionType::get(t_void, {t_voidp, t_voidp, t_int64, t_int64, t_voidp}, false);
+        f_vmReadMemory = Function::Create(t_access, GlobalValue::LinkageTypes::InternalLinkage, "llmc_vm_read", dmcModule);
+        f_vmWriteMemory = Function::Create(t_access, GlobalValue::LinkageTypes::InternalLinkage, "llmc_vm_write", dmcModule);
+        for(auto f: {f_vmReadMemory, f_vmWriteMemory}) {
+            auto args = f->arg_begin();
+            GenerationContext context;
+            context.gen = this;
+            context.userContext = &*args++;
+            Argument* pChunkMemory = &*args++;
+            Argument* offset = &*args++;
+            Argument* length = &*args++;
+            Argument* data = &*args++;
+            builder.SetInsertPoint(BasicBlock::Create(ctx, "entry", f));
+            auto pChunk = builder.CreatePointerCast(pChunkMemory, t_chunkid->getPointerTo());
+            if(f == f_vmReadMemory) {
+                generateMemoryRead(&context, pChunk, offset, length, data);
+            } else {
+                generateMemoryWrite(&context, pChunk, offset, length, data);
+            }
+            builder.CreateRetVoid();
+        }
+    }
+
+    /**
+     * @brief Returns whether @c I leaves the memory and the stack of the
+     * process alone, such that buffered stores can stay buffered across it.
+     */
+    bool isTransparentToStoreBuffer(Instruction* I) {
+        return isa<BinaryOperator>(I) || isa<CastInst>(I) || isa<CmpInst>(I) || isa<GetElementPtrInst>(I)
+            || isa<SelectInst>(I) || isa<ExtractValueInst>(I) || isa<InsertValueInst>(I);
+    }
+
+    /**
+     * @brief Generates the write of the buffered stores to the memory
+     * chunk, if a store was buffered since the last flush.
+     */
+    void generateFlushStores(GenerationContext* gctx) {
+        if(!gctx->storesBuffered) {
+            return;
+        }
+        auto f_flush = llmcvm_func("llmc_store_buffer_flush", true);
+        auto t_flush = f_flush->getFunctionType();
+        builder.CreateCall(f_flush, { builder.CreatePointerCast(gctx->userContext, t_flush->getParamType(0))
+                                    , builder.CreatePointerCast(f_vmWriteMemory, t_flush->getParamType(1))
+                                    , builder.CreatePointerCast(gctx->storeBuffer, t_flush->getParamType(2))
+                                    });
+        gctx->storesBuffered = false;
+    }
+
+    /**
+     * @brief Generates a copy of the memory of process @c processorID that
+     * the VM can work on: at least @c memorySize bytes, where the bytes
+     * beyond the end of the chunk are 0.
+     */
+    Value* generateDownloadProcessMemory(GenerationContext* gctx, Value* processorID, Value* memorySize) {
+        if(_pagedMemory) {
+            auto memory = builder.CreateAlloca(t_char, memorySize, "vm_memory");
+            generateMemoryRead(gctx, lts["processes"][processorID]["m"].getValue(gctx->svout), ConstantInt::get(t_int, 0), memorySize, memory);
+            return memory;
+        }
+        assert(!isBigChunkType(type_memory));
+        auto chunkMemory = builder.CreateLoad(t_chunkid, lts["processes"][processorID]["m"].getValue(gctx->svout), "chunkMemory");
+        auto length = builder.CreateIntCast(getLengthOfStateID(chunkMemory), t_int, false);
+        auto bufferSize = builder.CreateSelect(builder.CreateICmpUGT(length, memorySize), length, memorySize);
+        auto memory = builder.CreateAlloca(t_char, bufferSize, "vm_memory");
+        builder.CreateMemSet(memory, ConstantInt::get(t_int8, 0), bufferSize, MaybeAlign(1));
+        llvmgen::If If(builder, "if_memory_stored");
+        If.setCond(builder.CreateICmpNE(chunkMemory, ConstantInt::get(t_chunkid, 0)));
+        BasicBlock* BBTrue = If.getTrue();
+        If.generate();
+        auto BBEnd = builder.GetInsertBlock();
+        builder.SetInsertPoint(&*BBTrue->getFirstInsertionPt());
+        StateManager sm_memory(gctx->userContext, this, type_memory);
+        sm_memory.download(chunkMemory, memory);
+        builder.SetInsertPoint(BBEnd);
+        return memory;
+    }
+
+    /**
+     * @brief Generates the layout of the state-vector the VM needs to find
+     * the chunks of all processes, see LLMC_SV_* in libllmcvm.c.
+     */
+    Value* generateStateVectorLayout(GenerationContext* gctx) {
+        auto sv = builder.CreatePtrToInt(gctx->svout, t_int64);
+        auto offsetOf = [&](Value* p) {
+            return builder.CreateIntCast(builder.CreateSub(builder.CreatePtrToInt(p, t_int64), sv), t_int, false);
+        };
+        std::vector<Value*> layout;
+        layout.push_back(ConstantInt::get(t_int, maxThreads));
+        if(maxThreads > 1) {
+            layout.push_back(builder.CreateSub( offsetOf(lts["processes"][1]["pc"].getValue(gctx->svout))
+                                              , offsetOf(lts["processes"][0]["pc"].getValue(gctx->svout))
+                                              ));
+        } else {
+            layout.push_back(ConstantInt::get(t_int, 0));
+        }
+        layout.push_back(offsetOf(lts["processes"][0]["pc"].getValue(gctx->svout)));
+        layout.push_back(offsetOf(lts["processes"][0]["stk"].getValue(gctx->svout)));
+        layout.push_back(offsetOf(lts["processes"][0]["r"].getValue(gctx->svout)));
+        layout.push_back(offsetOf(lts["processes"][0]["m"].getValue(gctx->svout)));
+        layout.push_back(offsetOf(lts["tres"].getValue(gctx->svout)));
+        layout.push_back(builder.CreateIntCast(generateAlignedSizeOf(t_globals), t_int, false));
+        layout.push_back(offsetOf(lts["processes"][0].getValue(gctx->svout)));
+        layout.push_back(offsetOf(lts["processes"][0]["tid"].getValue(gctx->svout)));
+        layout.push_back(offsetOf(lts["processes"][0]["msize"].getValue(gctx->svout)));
+        layout.push_back(ConstantInt::get(t_int, _pagedMemory));
+        auto t_layout = ArrayType::get(t_int, layout.size());
+        auto pLayout = addAlloca(t_layout, builder.GetInsertBlock()->getParent());
+        for(size_t i = 0; i < layout.size(); ++i) {
+            builder.CreateStore(layout[i], builder.CreateGEP(t_layout, pLayout, {ConstantInt::get(t_int, 0), ConstantInt::get(t_int, i)}));
+        }
+        return pLayout;
+    }
+
+    /**
+     * @brief Generates the collection of the unreachable heap objects of
+     * process @c processorID by llmc_gc() of the VM. This needs the final
+     * state-vector, including the registers of the process. If the memory
+     * changed, the compacted memory is uploaded.
+     */
+    void generateCollectGarbage(GenerationContext* gctx, Value* processorID) {
+        auto pChunkMemory = lts["processes"][processorID]["m"].getValue(gctx->svout);
+        auto pMemorySize = lts["processes"][processorID]["msize"].getValue(gctx->svout);
+        Value* memorySize = builder.CreateLoad(t_int, pMemorySize, "memorySize");
+        auto memory = generateDownloadProcessMemory(gctx, processorID, memorySize);
+        auto layout = generateStateVectorLayout(gctx);
+
+        auto f_gc = llmcvm_func("llmc_gc", true);
+        auto t_gc = f_gc->getFunctionType();
+        Value* newSize = builder.CreateCall(f_gc, { builder.CreatePointerCast(gctx->userContext, t_gc->getParamType(0))
+                                                  , builder.CreatePointerCast(f_vmGetChunk, t_gc->getParamType(1))
+                                                  , builder.CreatePointerCast(gctx->svout, t_gc->getParamType(2))
+                                                  , builder.CreatePointerCast(layout, t_gc->getParamType(3))
+                                                  , builder.CreateIntCast(processorID, t_gc->getParamType(4), false)
+                                                  , builder.CreatePointerCast(memory, t_gc->getParamType(5))
+                                                  , builder.CreateIntCast(memorySize, t_gc->getParamType(6), false)
+                                                  });
+
+        // A negative size means nothing was collected
+        llvmgen::If If(builder, "if_gc_collected");
+        If.setCond(builder.CreateICmpSGE(newSize, ConstantInt::get(newSize->getType(), 0)));
+        BasicBlock* BBTrue = If.getTrue();
+        If.generate();
+        auto BBEnd = builder.GetInsertBlock();
+        builder.SetInsertPoint(&*BBTrue->getFirstInsertionPt());
+        newSize = builder.CreateIntCast(newSize, t_int, false);
+        builder.CreateStore(newSize, pMemorySize);
+        Instruction* upload;
+        Instruction* release;
+        SplitBlockAndInsertIfThenElse(builder.CreateICmpNE(newSize, ConstantInt::get(t_int, 0)), &*builder.GetInsertPoint(), &upload, &release);
+        builder.SetInsertPoint(upload);
+        builder.CreateStore(generateMemoryUpload(gctx->userContext, memory, newSize), pChunkMemory);
+        builder.SetInsertPoint(release);
+        builder.CreateStore(ConstantInt::get(t_chunkid, 0), pChunkMemory);
+        builder.SetInsertPoint(BBEnd);
+    }
+
+    /**
+     * @brief Generates the relabeling of the heap objects of process
+     * @c processorID by llmc_heap_canonicalize() of the VM, which rewrites
+     * the memory and gctx->registers. This needs the final state-vector,
+     * except for the registers of the process, which are stored after.
+     * Only the pointers in the globals, registers and objects at the
+     * offsets of generatePointerSlotTables() are rewritten.
+     */
+    void generateCanonicalizeHeap(GenerationContext* gctx, Value* processorID) {
+        if(!g_globalPointers) {
+            generatePointerSlotTables();
+        }
+        auto pc = builder.CreateLoad(t_int, lts["processes"][processorID]["pc"].getValue(gctx->svout), "pc");
+        auto t_starts = g_registerPointerStart->getValueType();
+        auto start = builder.CreateLoad(t_int, builder.CreateGEP(t_starts, g_registerPointerStart, {ConstantInt::get(t_int, 0), pc}), "registerPointerStart");
+        auto t_counts = g_registerPointerCount->getValueType();
+        auto count = builder.CreateLoad(t_int, builder.CreateGEP(t_counts, g_registerPointerCount, {ConstantInt::get(t_int, 0), pc}), "registerPointerCount");
+        auto t_pointers = g_registerPointers->getValueType();
+        auto registerPointers = builder.CreateGEP(t_pointers, g_registerPointers, {ConstantInt::get(t_int, 0), start});
+        auto globalPointers = builder.CreateGEP(g_globalPointers->getValueType(), g_globalPointers, {ConstantInt::get(t_int, 0), ConstantInt::get(t_int, 0)});
+        auto firstOf = [this](GlobalVariable* table) {
+            return builder.CreateGEP(table->getValueType(), table, {ConstantInt::get(t_int, 0), ConstantInt::get(t_int, 0)});
+        };
+
+        auto pChunkMemory = lts["processes"][processorID]["m"].getValue(gctx->svout);
+        Value* memorySize = builder.CreateLoad(t_int, lts["processes"][processorID]["msize"].getValue(gctx->svout), "memorySize");
+        auto memory = generateDownloadProcessMemory(gctx, processorID, memorySize);
+        auto layout = generateStateVectorLayout(gctx);
+
+        auto f_canonicalize = llmcvm_func("llmc_heap_canonicalize", true);
+        auto t_canonicalize = f_canonicalize->getFunctionType();
+        Value* changed = builder.CreateCall(f_canonicalize, { builder.CreatePointerCast(gctx->userContext, t_canonicalize->getParamType(0))
+                                                            , builder.CreatePointerCast(f_vmGetChunk, t_canonicalize->getParamType(1))
+                                                            , builder.CreatePointerCast(gctx->svout, t_canonicalize->getParamType(2))
+                                                            , builder.CreatePointerCast(layout, t_canonicalize->getParamType(3))
+                                                            , builder.CreateIntCast(processorID, t_canonicalize->getParamType(4), false)
+                                                            , builder.CreatePointerCast(memory, t_canonicalize->getParamType(5))
+                                                            , builder.CreateIntCast(memorySize, t_canonicalize->getParamType(6), false)
+                                                            , builder.CreatePointerCast(gctx->registers, t_canonicalize->getParamType(7))
+                                                            , builder.CreateIntCast(t_registers_max_size, t_canonicalize->getParamType(8), false)
+                                                            , builder.CreatePointerCast(globalPointers, t_canonicalize->getParamType(9))
+                                                            , ConstantInt::get(t_canonicalize->getParamType(10), globalPointerCount)
+                                                            , builder.CreatePointerCast(registerPointers, t_canonicalize->getParamType(11))
+                                                            , builder.CreateIntCast(count, t_canonicalize->getParamType(12), false)
+                                                            , builder.CreatePointerCast(firstOf(g_sitePointers), t_canonicalize->getParamType(13))
+                                                            , builder.CreatePointerCast(firstOf(g_sitePointerStart), t_canonicalize->getParamType(14))
+                                                            , builder.CreatePointerCast(firstOf(g_sitePointerCount), t_canonicalize->getParamType(15))
+                                                            , builder.CreatePointerCast(firstOf(g_siteStride), t_canonicalize->getParamType(16))
+                                                            , ConstantInt::get(t_canonicalize->getParamType(17), allocationSiteTypes.size())
+                                                            });
+
+        // Relabeling moves objects, so the memory is not empty
+        llvmgen::If If(builder, "if_heap_relabeled");
+        If.setCond(builder.CreateICmpNE(changed, ConstantInt::get(changed->getType(), 0)));
+        BasicBlock* BBTrue = If.getTrue();
+        If.generate();
+        auto BBEnd = builder.GetInsertBlock();
+        builder.SetInsertPoint(&*BBTrue->getFirstInsertionPt());
+        builder.CreateStore(generateMemoryUpload(gctx->userContext, memory, memorySize), pChunkMemory);
+        builder.SetInsertPoint(BBEnd);
+    }
+
+    /**
+     * @brief Generates the table of the function of every program location,
+     * see g_locationFunctions. Functions are numbered in the order of the
+     * module, from 1.
+     */
+    void generateLocationFunctions() {
+        std::unordered_map<Function*, uint32_t> functionIndices;
+        uint32_t index = 0;
+        for(auto& F: *module) {
+            functionIndices[&F] = ++index;
+        }
+
+        std::vector<Constant*> entries(nextProgramLocation, ConstantInt::get(t_int, 0));
+        for(auto& kv: programLocations) {
+            if(!kv.first) continue;
+            entries[kv.second] = ConstantInt::get(t_int, functionIndices[kv.first->getFunction()]);
+        }
+        auto t_table = ArrayType::get(t_int, entries.size());
+        g_locationFunctions = new GlobalVariable( *dmcModule
+                                                , t_table
+                                                , true
+                                                , GlobalValue::LinkageTypes::InternalLinkage
+                                                , ConstantArray::get(t_table, entries)
+                                                , "llmc_location_functions"
+                                                );
+    }
 
-        // Get the size of the SV
-        t_statevector_size = generateAlignedSizeOf(t_statevector);
-        assert(t_statevector_size);
+    /**
+     * @brief Generates the reordering of the running threads by
+     * llmc_thread_canonicalize() of the VM, which rewrites the state-vector
+     * in place. This needs the final state-vector.
+     */
+    void generateCanonicalizeThreads(GenerationContext* gctx) {
+        if(!g_locationFunctions) {
+            generateLocationFunctions();
+        }
+        auto layout = generateStateVectorLayout(gctx);
+        auto f_canonicalize = llmcvm_func("llmc_thread_canonicalize", true);
+        auto t_canonicalize = f_canonicalize->getFunctionType();
+        builder.CreateCall(f_canonicalize, { builder.CreatePointerCast(gctx->userContext, t_canonicalize->getParamType(0))
+                                           , builder.CreatePointerCast(f_vmGetChunk, t_canonicalize->getParamType(1))
+                                           , builder.CreatePointerCast(gctx->svout, t_canonicalize->getParamType(2))
+                                           , builder.CreatePointerCast(layout, t_canonicalize->getParamType(3))
+                                           , builder.CreatePointerCast(builder.CreateGEP(g_locationFunctions->getValueType(), g_locationFunctions, {ConstantInt::get(t_int, 0), ConstantInt::get(t_int, 0)}), t_canonicalize->getParamType(4))
+                                           });
     }
 
     void generateInitialState() {
@@ -1555,7 +3139,7 @@ public:
             Value* cond = lts["status"].getValue(gctx_copy.src);
             cond = builder.CreateLoad(t_int, cond, "status");
             cond = builder.CreateICmpEQ(cond, ConstantInt::get(t_int, 0));
-            for(int i = 0; i < MAX_THREADS; ++i) {
+            for(int i = 0; i < maxThreads; ++i) {
                 auto src_pc = lts["processes"][i]["pc"].getValue(gctx_copy.src);
                 auto pc = builder.CreateLoad(t_int, src_pc, "pc");
                 auto cond2 = builder.CreateICmpEQ(pc, ConstantInt::get(t_int, 0));
@@ -1618,7 +3202,7 @@ public:
             Value* cond = lts["status"].getValue(gctx_copy.src);
             cond = builder.CreateLoad(t_int, cond, "status");
             cond = builder.CreateICmpEQ(cond, ConstantInt::get(t_int, 1));
-            for(int i = 0; i < MAX_THREADS; ++i) {
+            for(int i = 0; i < maxThreads; ++i) {
                 auto src_pc = lts["processes"][i]["pc"].getValue(gctx_copy.src);
                 auto pc = builder.CreateLoad(t_int, src_pc, "pc");
                 auto cond2 = builder.CreateICmpEQ(pc, ConstantInt::get(t_int, 0));
@@ -1699,10 +3283,10 @@ public:
                 return true;
             case Instruction::Load: {
                 LoadInst* L = dyn_cast<LoadInst>(I);
-                return _assumeNonAtomicCollapsable && !L->isAtomic();
+                return (_assumeNonAtomicCollapsable && !L->isAtomic()) || isThreadLocalAccess(I);
             } case Instruction::Store: {
                 StoreInst* S = dyn_cast<StoreInst>(I);
-                return _assumeNonAtomicCollapsable && !S->isAtomic();
+                return (_assumeNonAtomicCollapsable && !S->isAtomic()) || isThreadLocalAccess(I);
             } case Instruction::Ret:
                 return true; // I think this is fine
             case Instruction::Br:
@@ -1740,6 +3324,9 @@ public:
                     if(F->getName().equals("malloc")) {
                         return true;
                     }
+                    if(F->getName().equals("free")) {
+                        return _assumeNonAtomicCollapsable;
+                    }
                     if(F->getName().equals("pthread_join")) {
                         return true;
                     }
@@ -1767,10 +3354,10 @@ public:
                 return true;
             case Instruction::Load: {
                 LoadInst* L = dyn_cast<LoadInst>(I);
-                return _assumeNonAtomicCollapsable && !L->isAtomic();
+                return (_assumeNonAtomicCollapsable && !L->isAtomic()) || isThreadLocalAccess(I);
             } case Instruction::Store: {
                 StoreInst* S = dyn_cast<StoreInst>(I);
-                return _assumeNonAtomicCollapsable && !S->isAtomic();
+                return (_assumeNonAtomicCollapsable && !S->isAtomic()) || isThreadLocalAccess(I);
             } case Instruction::Ret:
                 return true; // I think this is fine
             case Instruction::Br:
@@ -1808,6 +3395,9 @@ public:
                     if(F->getName().equals("malloc")) {
                         return true;
                     }
+                    if(F->getName().equals("free")) {
+                        return _assumeNonAtomicCollapsable;
+                    }
                     return false;
                 }
                 return false; // sadly the rest of the llvm front-end does not read the updated PC
@@ -1832,10 +3422,10 @@ public:
                 return true;
             case Instruction::Load: {
                 LoadInst* L = dyn_cast<LoadInst>(I);
-                return _assumeNonAtomicCollapsable && !L->isAtomic();
+                return (_assumeNonAtomicCollapsable && !L->isAtomic()) || isThreadLocalAccess(I);
             } case Instruction::Store: {
                 StoreInst* S = dyn_cast<StoreInst>(I);
-                return _assumeNonAtomicCollapsable && !S->isAtomic();
+                return (_assumeNonAtomicCollapsable && !S->isAtomic()) || isThreadLocalAccess(I);
             } case Instruction::Ret:
                 return true; // I think this is fine
             case Instruction::Br:
@@ -1873,6 +3463,9 @@ public:
                     if(F->getName().equals("malloc")) {
                         return true;
                     }
+                    if(F->getName().equals("free")) {
+                        return _assumeNonAtomicCollapsable;
+                    }
                     return false;
                 }
                 return true;
@@ -1977,7 +3570,7 @@ public:
         }
 
         // Create the TG
-        for(int i = 0; i < MAX_THREADS; ++i) {
+        for(int i = 0; i < maxThreads; ++i) {
             auto tg = new TransitionGroupInstructions(i, instructions, {}, {}, emitter);
             tg->setDesc(rdesc.str() + (emitter ? " [emitter]" : ""));
             addTransitionGroup(tg);
@@ -2056,6 +3649,9 @@ public:
      * @return The model-register assocated with the specified program-register
      */
     Value* vReg(Value* registers, Function& F, std::string name, Value* reg) {
+        if(inlineFrameFunctions.count(&F)) {
+            registers = generatePointerAdd(registers, ConstantInt::get(t_int, inlineFrameOffset));
+        }
         auto regs = builder.CreateBitOrPointerCast(registers, PointerType::get(registerLayout[&F].registerLayout, 0),
                                                    F.getName().str() + "_registers"
         );
@@ -2132,6 +3728,19 @@ public:
         return makePointer(ConstantInt::get(t_int64, 0), v, v->getType());
     }
 
+    /**
+     * @brief Returns whether an element of the vector constant @c cv needs
+     * to be mapped by vMap().
+     */
+    bool hasMappedElements(ConstantVector* cv) {
+        for(auto& element: cv->operands()) {
+            if(isa<GlobalValue>(element) || isa<ConstantExpr>(element)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
     /**
      * @brief This makes sure that the specified program-Value is mapped
      * to a model-Value in a register. As source-Value can be specified
@@ -2193,6 +3802,21 @@ public:
             builder.Insert(result);
             return result;
 
+        // Vector constants with an element that is a global, a function or a
+        // ConstantExpr are built from the mapped elements, like ConstantExprs
+        } else if(isa<ConstantVector>(OI) && hasMappedElements(cast<ConstantVector>(OI))) {
+            auto cv = cast<ConstantVector>(OI);
+            auto elementType = cv->getType()->getElementType();
+            Value* result = UndefValue::get(cv->getType());
+            for(unsigned int i = 0; i < cv->getNumOperands(); ++i) {
+                auto element = vMap(gctx, cv->getOperand(i));
+                if(element->getType() != elementType) {
+                    element = builder.CreateBitOrPointerCast(element, elementType);
+                }
+                result = builder.CreateInsertElement(result, element, (uint64_t)i);
+            }
+            return result;
+
         // Leave constants as they are
         } else if(dyn_cast<Constant>(OI)) {
             if(auto func = dyn_cast<Function>(OI)) {
@@ -2207,7 +3831,7 @@ public:
         // If we have a known mapping, perform the mapping
         } else if(valueRegisterIndex.count(OI) > 0) {
 //            assert(!OI->getType()->isStructTy());
-            Value* registers = lts["processes"][gctx->thread_id]["r"].getValue(gctx->svout);
+            Value* registers = gctx->registers;
             auto load = builder.CreateLoad(vReg(registers, OI));
             load->setAlignment(Align(1));
             return load;
@@ -2271,7 +3895,7 @@ public:
         // If the instruction has a return value, store the result in the SV
         if(IC->getType() != t_void) {
             assert(valueRegisterIndex[I]);
-            auto registers = lts["processes"][gctx->thread_id]["r"].getValue(gctx->svout);
+            auto registers = gctx->registers;
             auto store = builder.CreateStore(IC, vReg(registers, I));
             store->setAlignment(Align(1));
             setDebugLocation(store, __FILE__, __LINE__ - 2);
@@ -2308,6 +3932,8 @@ public:
                 return generateNextStateForInstruction(gctx, dyn_cast<ReturnInst>(I));
             case Instruction::Br:
                 return generateNextStateForInstruction(gctx, dyn_cast<BranchInst>(I));
+            case Instruction::Switch:
+                return generateNextStateForInstruction(gctx, dyn_cast<SwitchInst>(I));
             case Instruction::AtomicCmpXchg:
                 return generateNextStateForInstruction(gctx, dyn_cast<AtomicCmpXchgInst>(I));
             case Instruction::Call:
@@ -2321,7 +3947,6 @@ public:
                 return nullptr;
             case Instruction::AtomicRMW:
                 return generateNextStateForInstruction(gctx, dyn_cast<AtomicRMWInst>(I));
-            case Instruction::Switch:
             case Instruction::IndirectBr:
             case Instruction::Invoke:
             case Instruction::Resume:
@@ -2331,7 +3956,6 @@ public:
             case Instruction::Fence:
             case Instruction::CleanupPad:
             case Instruction::VAArg:
-            case Instruction::ShuffleVector:
             case Instruction::LandingPad:
                 roout << "Unsupported instruction: " << *I << "\n";
                 roout.flush();
@@ -2340,6 +3964,7 @@ public:
             case Instruction::InsertValue:
             case Instruction::ExtractElement:
             case Instruction::InsertElement:
+            case Instruction::ShuffleVector:
             default:
                 break;
         }
@@ -2350,7 +3975,7 @@ public:
 
     Value* generateNextStateForInstruction(GenerationContext* gctx, AtomicRMWInst* I) {
         assert(I);
-        auto registers = lts["processes"][gctx->thread_id]["r"].getValue(gctx->svout);
+        auto registers = gctx->registers;
         Value* ptr = vGetMemOffset(gctx, registers, I->getPointerOperand());
         Value* val = vMap(gctx, I->getValOperand());
         Value* newVal = nullptr;
@@ -2425,67 +4050,33 @@ public:
 
     Value* generateNextStateForInstruction(GenerationContext* gctx, AtomicCmpXchgInst* I) {
         assert(I);
-        auto registers = lts["processes"][gctx->thread_id]["r"].getValue(gctx->svout);
+        auto registers = gctx->registers;
         Value* ptr = vGetMemOffset(gctx, registers, I->getPointerOperand());
         Value* expected = vMap(gctx, I->getCompareOperand());
 //        Value* expected_ptr = vGetMemOffset(gctx, registers, I->getCompareOperand());
         expected->setName("expected");
         Value* desired = vMap(gctx, I->getNewValOperand());
         desired->setName("desired");
-        Type* type = I->getNewValOperand()->getType();
-
-        auto storagePtr = generateAccessToMemory(gctx, ptr, type);
-        storagePtr->setName("storagePtr");
-        auto loadedPtr = builder.CreateLoad(storagePtr);
-        loadedPtr->setAlignment(Align(1));
-        loadedPtr->setName("loaded_ptr");
-
-        auto cmp = builder.CreateICmpEQ(loadedPtr, expected);
 
-        llvmgen::If genIf(builder, "cmpxchg_impl");
+        Value* loaded;
+        auto success = generateCompareAndSwap(gctx, ptr, expected, desired, loaded);
 
         Value* resultReg = vReg(registers, I);
         auto resultRegValue = builder.CreateGEP(I->getType(), resultReg, {ConstantInt::get(t_int, 0), ConstantInt::get(t_int, 0)});
         auto resultRegSuccess = builder.CreateGEP(I->getType(), resultReg, {ConstantInt::get(t_int, 0), ConstantInt::get(t_int, 1)});
-
-        builder.CreateStore(loadedPtr, resultRegValue)->setAlignment(Align(1));
-        genIf.setCond(cmp);
-        auto bbTrue = genIf.getTrue();
-        auto bbFalse = genIf.getFalse();
-        genIf.generate();
-
-        builder.SetInsertPoint(&*bbTrue->getFirstInsertionPt());
-        generateStore(gctx, ptr, desired, type);
-        builder.CreateStore(ConstantInt::get(t_bool, 1), resultRegSuccess)->setAlignment(Align(1));
-
-//        builder.CreateCall( pins("printf")
-//                , { generateGlobalString("[memory inst] cmpxchg \033[1m%zx\033[0m %u==%u %u: success\n")
-//                                    , ptr
-//                                    , loadedPtr
-//                                    , expected
-//                                    , desired
-//                           }
-//        );
-
-        builder.SetInsertPoint(&*bbFalse->getFirstInsertionPt());
-//        generateStore(gctx, expected_ptr, loadedPtr, type);
-        builder.CreateStore(ConstantInt::get(t_bool, 0), resultRegSuccess)->setAlignment(Align(1));
-
-//        builder.CreateCall( pins("printf")
-//                , { generateGlobalString("cmpxchg \033[1m%zx\033[0m %u!=%u %u: failure\n")
-//                                    , ptr
-//                                    , loadedPtr
-//                                    , expected
-//                                    , desired
-//                            }
-//        );
-
-        builder.SetInsertPoint(genIf.getFinal());
+        builder.CreateStore(loaded, resultRegValue)->setAlignment(Align(1));
+        builder.CreateStore(success, resultRegSuccess)->setAlignment(Align(1));
         return nullptr;
-
     }
 
     Value* generateNextStateForInstruction(GenerationContext* gctx, GetElementPtrInst* I) {
+        if(I->getType()->isVectorTy()) {
+            std::string str;
+            raw_string_ostream ros(str);
+            ros << *I;
+            ros.flush();
+            out.reportError("Vector getelementptr is not supported: " + str);
+        }
         return generateNextStateForInstructionValueMapped(gctx, I);
 //        auto registers = lts["processes"][gctx->thread_id]["r"].getValue(gctx->svout);
 //        auto v = vReg(registers, I);
@@ -2509,7 +4100,7 @@ public:
     }
 
     Value* generateNextStateForInstruction(GenerationContext* gctx, ExtractValueInst* I) {
-        auto registers = lts["processes"][gctx->thread_id]["r"].getValue(gctx->svout);
+        auto registers = gctx->registers;
         auto arg = vReg(registers, I->getAggregateOperand());
 
         std::vector<Value*> idxs;
@@ -2610,6 +4201,7 @@ public:
                 } else if(F->getName().equals("__atomic_store")) {
                 } else if(F->getName().equals("__atomic_compare_exchange")) {
                 } else if(F->getName().equals("malloc")) { // __LLMCOS_Object_New
+                } else if(F->getName().equals("free")) { // __LLMCOS_Object_Free
                 } else if(F->getName().equals("__LLMCOS_Object_CheckAccess")) {
                 } else if(F->getName().equals("__LLMCOS_Object_CheckNotOverlapping")) {
                 } else if(F->getName().equals("__LLMCOS_Fatal")) {
@@ -2622,7 +4214,7 @@ public:
                     // int pthread_join(pthread_t thread, void **value_ptr);
 
 
-                    auto registers = lts["processes"][gctx->thread_id]["r"].getValue(gctx->svout);
+                    auto registers = gctx->registers;
 
                     auto elementLength = generateSizeOf(type_threadresults_element->getLLVMType());
                     auto result = builder.CreateAlloca(type_threadresults_element->getLLVMType());
@@ -2677,8 +4269,8 @@ public:
      */
     Value* generateNextStateForInstruction(GenerationContext* gctx, AllocaInst* I) {
         Value* size = generateAlignedSizeOf(I->getAllocatedType());
-        Value* ptr = generateAllocateMemory(gctx, size);
-        auto registers = lts["processes"][gctx->thread_id]["r"].getValue(gctx->svout);
+        Value* ptr = trackObjects() ? generateAllocateObject(gctx, size, OBJECT_STACK, getAllocationSite(I)) : generateAllocateMemory(gctx, size);
+        auto registers = gctx->registers;
         Value* ret = vReg(registers, I);
         ptr = gctx->gen->builder.CreateIntToPtr(ptr, I->getType());
         auto store = gctx->gen->builder.CreateStore(ptr, ret);
@@ -2807,6 +4399,10 @@ public:
 //        return v;
 //    }
 
+    /**
+     * @brief The length in bytes of the chunk with ID @c v, which must not be
+     * stored using the dmc_big_* API, see determineBigChunkTypes().
+     */
     Value* getLengthOfStateID(Value* v) {
         v = builder.CreateLShr(v, 40);
         return v;
@@ -2847,6 +4443,142 @@ public:
         }
     }
 
+    /**
+     * @brief Generates the read of @c size bytes at @c offset of the memory
+     * chunk at @c pChunkMemory into @c data. The memory view is consulted
+     * first and stores that are still in the store buffer are taken into
+     * account.
+     */
+    void generateMemoryRead(GenerationContext* gctx, Value* pChunkMemory, Value* offset, Value* size, Value* data) {
+        if(gctx->memoryView) {
+            auto f_view = llmcvm_func("llmc_memory_view_read", true);
+            auto t_view = f_view->getFunctionType();
+            builder.CreateCall(f_view, { builder.CreatePointerCast(gctx->userContext, t_view->getParamType(0))
+                                       , builder.CreatePointerCast(f_vmReadMemory, t_view->getParamType(1))
+                                       , builder.CreatePointerCast(gctx->memoryView, t_view->getParamType(2))
+                                       , builder.CreatePointerCast(pChunkMemory, t_view->getParamType(3))
+                                       , ConstantInt::get(t_view->getParamType(4), _pagedMemory)
+                                       , builder.CreateIntCast(offset, t_view->getParamType(5), false)
+                                       , builder.CreateIntCast(size, t_view->getParamType(6), false)
+                                       , builder.CreatePointerCast(data, t_view->getParamType(7))
+                                       });
+        } else {
+            generateMemoryReadRaw(gctx, pChunkMemory, offset, size, data);
+        }
+        if(gctx->bufferStores) {
+            auto f_read = llmcvm_func("llmc_store_buffer_read", true);
+            auto t_read = f_read->getFunctionType();
+            builder.CreateCall(f_read, { builder.CreatePointerCast(gctx->storeBuffer, t_read->getParamType(0))
+                                       , builder.CreatePointerCast(pChunkMemory, t_read->getParamType(1))
+                                       , builder.CreateIntCast(offset, t_read->getParamType(2), false)
+                                       , builder.CreateIntCast(size, t_read->getParamType(3), false)
+                                       , builder.CreatePointerCast(data, t_read->getParamType(4))
+                                       });
+        }
+    }
+
+    /**
+     * @brief Generates the read of @c size bytes at @c offset of the memory
+     * chunk at @c pChunkMemory into @c data, bypassing the memory view and
+     * the store buffer.
+     */
+    void generateMemoryReadRaw(GenerationContext* gctx, Value* pChunkMemory, Value* offset, Value* size, Value* data) {
+        if(_pagedMemory) {
+            auto f_read = llmcvm_func("llmc_paged_read", true);
+            auto t_read = f_read->getFunctionType();
+            builder.CreateCall(f_read, { builder.CreatePointerCast(gctx->userContext, t_read->getParamType(0))
+                                       , builder.CreatePointerCast(f_vmGetChunk, t_read->getParamType(1))
+                                       , builder.CreateLoad(t_chunkid, pChunkMemory, "chunkMemory")
+                                       , builder.CreateIntCast(offset, t_read->getParamType(3), false)
+                                       , builder.CreateIntCast(size, t_read->getParamType(4), false)
+                                       , builder.CreatePointerCast(data, t_read->getParamType(5))
+                                       });
+        } else {
+            StateManager sm_memory(gctx->userContext, this, type_memory);
+            sm_memory.downloadPartBytes(pChunkMemory, offset, size, data);
+        }
+    }
+
+    /**
+     * @brief Generates the write of @c size bytes of @c data at @c offset
+     * of the memory chunk at @c pChunkMemory. While memory accesses go
+     * through the store buffer, the write is buffered instead.
+     */
+    void generateMemoryWrite(GenerationContext* gctx, Value* pChunkMemory, Value* offset, Value* size, Value* data) {
+        if(gctx->bufferStores) {
+            auto f_write = llmcvm_func("llmc_store_buffer_write", true);
+            auto t_write = f_write->getFunctionType();
+            builder.CreateCall(f_write, { builder.CreatePointerCast(gctx->userContext, t_write->getParamType(0))
+                                        , builder.CreatePointerCast(f_vmReadMemory, t_write->getParamType(1))
+                                        , builder.CreatePointerCast(f_vmWriteMemory, t_write->getParamType(2))
+                                        , builder.CreatePointerCast(gctx->storeBuffer, t_write->getParamType(3))
+                                        , builder.CreatePointerCast(pChunkMemory, t_write->getParamType(4))
+                                        , builder.CreateIntCast(offset, t_write->getParamType(5), false)
+                                        , builder.CreateIntCast(size, t_write->getParamType(6), false)
+                                        , builder.CreatePointerCast(data, t_write->getParamType(7))
+                                        });
+            gctx->storesBuffered = true;
+            return;
+        }
+        Value* oldMem = nullptr;
+        if(gctx->memoryView) {
+            oldMem = builder.CreateLoad(t_chunkid, pChunkMemory, "chunkMemoryBefore");
+        }
+        Value* newMem;
+        if(_pagedMemory) {
+            auto f_write = llmcvm_func("llmc_paged_write", true);
+            auto t_write = f_write->getFunctionType();
+            newMem = builder.CreateCall(f_write, { builder.CreatePointerCast(gctx->userContext, t_write->getParamType(0))
+                                                 , builder.CreatePointerCast(f_vmGetChunk, t_write->getParamType(1))
+                                                 , builder.CreatePointerCast(f_vmPutChunk, t_write->getParamType(2))
+                                                 , builder.CreateLoad(t_chunkid, pChunkMemory, "chunkMemory")
+                                                 , builder.CreateIntCast(offset, t_write->getParamType(4), false)
+                                                 , builder.CreateIntCast(size, t_write->getParamType(5), false)
+                                                 , builder.CreatePointerCast(data, t_write->getParamType(6))
+                                                 });
+        } else {
+            StateManager sm_memory(gctx->userContext, this, type_memory);
+            newMem = sm_memory.deltaBytes(pChunkMemory, offset, size, data);
+        }
+        builder.CreateStore(newMem, pChunkMemory)->setAlignment(Align(1));
+
+        // Carry the memory view over to the new chunk
+        if(oldMem) {
+            auto f_view = llmcvm_func("llmc_memory_view_write", true);
+            auto t_view = f_view->getFunctionType();
+            builder.CreateCall(f_view, { builder.CreatePointerCast(gctx->memoryView, t_view->getParamType(0))
+                                       , builder.CreatePointerCast(pChunkMemory, t_view->getParamType(1))
+                                       , builder.CreateIntCast(oldMem, t_view->getParamType(2), false)
+                                       , builder.CreateIntCast(offset, t_view->getParamType(3), false)
+                                       , builder.CreateIntCast(size, t_view->getParamType(4), false)
+                                       , builder.CreatePointerCast(data, t_view->getParamType(5))
+                                       });
+        }
+    }
+
+    /**
+     * @brief Generates the upload of @c size bytes of @c data as a new
+     * memory chunk.
+     * @return The chunk ID of the memory.
+     */
+    Value* generateMemoryUpload(Value* userContext, Value* data, Value* size) {
+        if(_pagedMemory) {
+            auto f_write = llmcvm_func("llmc_paged_write", true);
+            auto t_write = f_write->getFunctionType();
+            return builder.CreateCall(f_write, { builder.CreatePointerCast(userContext, t_write->getParamType(0))
+                                               , builder.CreatePointerCast(f_vmGetChunk, t_write->getParamType(1))
+                                               , builder.CreatePointerCast(f_vmPutChunk, t_write->getParamType(2))
+                                               , ConstantInt::get(t_write->getParamType(3), 0)
+                                               , ConstantInt::get(t_write->getParamType(4), 0)
+                                               , builder.CreateIntCast(size, t_write->getParamType(5), false)
+                                               , builder.CreatePointerCast(data, t_write->getParamType(6))
+                                               });
+        } else {
+            StateManager sm_memory(userContext, this, type_memory);
+            return sm_memory.uploadBytes(data, size);
+        }
+    }
+
     Value* generateAccessToMemory(GenerationContext* gctx, Value* modelPointer, Value* size) {
         if(!modelPointer->getType()->isIntegerTy()) {
             std::string str;
@@ -2855,13 +4587,12 @@ public:
             ros.flush();
             out.reportError("internal: need integer as pointer into memory: " + str);
         }
-        StateManager sm_memory(gctx->userContext, this, type_memory);
         auto processorID = getCreatorProcessorIDOfPointer(modelPointer);
         auto chunkMemory = lts["processes"][processorID]["m"].getValue(gctx->svout);
         chunkMemory->setName("chunkMemory");
         auto storage = addAlloca(gctx->gen->t_char, builder.GetInsertBlock()->getParent(), size);
         auto offset = getOffsetPartOfPointer(modelPointer);
-        sm_memory.downloadPartBytes(chunkMemory, offset, size, storage);
+        generateMemoryRead(gctx, chunkMemory, offset, size, storage);
         return storage;
 
 //        auto chunk = cm_memory.generateGet(chunkMemory);
@@ -2871,7 +4602,7 @@ public:
     }
 
     Value* generateAccessToMemory(GenerationContext* gctx, Value* modelPointer, Type* type) {
-        auto v = generateAccessToMemory(gctx, modelPointer, generateAlignedSizeOf(type));
+        auto v = generateAccessToMemory(gctx, modelPointer, generateAccessSizeOf(type));
         return builder.CreatePointerCast(v, type->getPointerTo());
     }
 
@@ -2887,7 +4618,6 @@ public:
     }
 
     void generateStore(GenerationContext* gctx, Value* modelPointer, Value* dataPointerOrRegister, Type* type) {
-        StateManager sm_memory(gctx->userContext, this, type_memory);
         auto processorID = getCreatorProcessorIDOfPointer(modelPointer);
 
 //        llvmgen::If2 genIf(builder, builder.CreateICmpEQ(processorID, ConstantInt::get(t_int64, -1, false)), "generatestore_ptrcheck");
@@ -2924,19 +4654,65 @@ public:
         }
 //        builder.CreateCall(pins("llmc_memory_check"), {modelPointer});
         auto offset = getOffsetPartOfPointer(modelPointer);
-        auto newMem = sm_memory.deltaBytes(chunkMemory, offset, generateAlignedSizeOf(type), dataPointerOrRegister);
-        builder.CreateStore(newMem, chunkMemory)->setAlignment(Align(1));
+        generateMemoryWrite(gctx, chunkMemory, offset, generateAccessSizeOf(type), dataPointerOrRegister);
     }
 
     void generateStore(GenerationContext* gctx, Value* modelPointer, Value* dataPointerOrRegister, Value* size) {
-        StateManager sm_memory(gctx->userContext, this, type_memory);
         auto processorID = getCreatorProcessorIDOfPointer(modelPointer);
         auto chunkMemory = lts["processes"][processorID]["m"].getValue(gctx->svout);
 //        auto registers = lts["processes"][gctx->thread_id]["r"].getValue(gctx->svout);
 //        builder.CreateCall(pins("llmc_memory_check"), {modelPointer});
         auto offset = getOffsetPartOfPointer(modelPointer);
-        auto newMem = sm_memory.deltaBytes(chunkMemory, offset, size, dataPointerOrRegister);
-        builder.CreateStore(newMem, chunkMemory)->setAlignment(Align(1));
+        generateMemoryWrite(gctx, chunkMemory, offset, size, dataPointerOrRegister);
+    }
+
+    /**
+     * @brief Generates a compare-and-swap of the value at @c modelPointer:
+     * if it equals @c expected, it is replaced by @c desired. Only the bytes
+     * of the value are read from the memory chunk and it is only modified
+     * when the comparison succeeds.
+     * @return Whether the value was replaced; @c loaded is set to the value
+     * that was read.
+     */
+    Value* generateCompareAndSwap(GenerationContext* gctx, Value* modelPointer, Value* expected, Value* desired, Value*& loaded) {
+        auto processorID = getCreatorProcessorIDOfPointer(modelPointer);
+        auto chunkMemory = lts["processes"][processorID]["m"].getValue(gctx->svout);
+        auto offset = getOffsetPartOfPointer(modelPointer);
+        if(!_pagedMemory) {
+            StateManager sm_memory(gctx->userContext, this, type_memory);
+            return sm_memory.compareAndDeltaBytes(chunkMemory, offset, expected, desired, loaded);
+        }
+
+        auto valueType = expected->getType();
+        auto size = generateSizeOf(valueType);
+        auto current = addAlloca(valueType, builder.GetInsertBlock()->getParent());
+        generateMemoryRead(gctx, chunkMemory, offset, size, current);
+        auto load = builder.CreateLoad(valueType, current, "cas_loaded");
+        load->setAlignment(Align(1));
+        loaded = load;
+        auto success = builder.CreateICmpEQ(loaded, expected, "cas_success");
+
+        // Split before the insertion point, or at the end of the block
+        Instruction* placeholder = nullptr;
+        if(builder.GetInsertPoint() == builder.GetInsertBlock()->end()) {
+            placeholder = builder.CreateUnreachable();
+            builder.SetInsertPoint(placeholder);
+        }
+        auto next = &*builder.GetInsertPoint();
+
+        builder.SetInsertPoint(SplitBlockAndInsertIfThen(success, next, false));
+        auto newValue = addAlloca(valueType, builder.GetInsertBlock()->getParent());
+        builder.CreateStore(desired, newValue)->setAlignment(Align(1));
+        generateMemoryWrite(gctx, chunkMemory, offset, size, newValue);
+
+        if(placeholder) {
+            auto BB = placeholder->getParent();
+            placeholder->eraseFromParent();
+            builder.SetInsertPoint(BB);
+        } else {
+            builder.SetInsertPoint(next);
+        }
+        return success;
     }
 
 //    void generateNextStateForStoreInstruction(GenerationContext* gctx, StoreInst* I) {
@@ -2986,6 +4762,160 @@ public:
         return makePointer(processorID, currentMemorySize, t_int64);
     }
 
+    /**
+     * The kind of an object in the memory of a process, stored in its header.
+     * Must match libllmcvm.c.
+     */
+    enum ObjectKind {
+        OBJECT_STACK = 1,
+        OBJECT_HEAP = 2,
+        OBJECT_FREED = 3,
+    };
+
+    /**
+     * The header in front of an object: the size of the object, rounded up
+     * to 8 bytes, and its kind, each 32 bits. The bits of the kind above the
+     * lowest 8 hold the allocation site, see allocationSites.
+     */
+    static constexpr uint64_t OBJECT_HEADER_SIZE = 8;
+
+    /**
+     * @brief Allocates an object of @c size bytes preceded by a header, such
+     * that it can be freed and the collector can walk the memory.
+     * @param site The allocation site of the object, or 0
+     * @return The model pointer to the object, after the header.
+     */
+    Value* generateAllocateObject(GenerationContext* gctx, Value* size, ObjectKind kind, uint32_t site = 0) {
+        size = builder.CreateIntCast(size, t_int64, false);
+        size = builder.CreateAnd( builder.CreateAdd(size, ConstantInt::get(t_int64, 7))
+                                , ConstantInt::get(t_int64, ~7ULL)
+                                );
+        auto header = generateAllocateMemory(gctx, builder.CreateAdd(size, ConstantInt::get(t_int64, OBJECT_HEADER_SIZE)));
+        assert(site < (1U << 24));
+        auto headerValue = builder.CreateOr(size, ConstantInt::get(t_int64, ((uint64_t)kind | (uint64_t)site << 8) << 32));
+        generateStore(gctx, header, headerValue, t_int64);
+        return builder.CreateAdd(header, ConstantInt::get(header->getType(), OBJECT_HEADER_SIZE));
+    }
+
+    /**
+     * @brief Generates free(@c pointer): the object is zeroed and marked as
+     * freed, so the memory of a process does not depend on what a freed
+     * object held. If the object is the last one in the memory of its
+     * creator, the memory is truncated to before its header. Freeing
+     * anything but a live heap object ends the program with a failure, like
+     * __LLMCOS_Fatal(). This includes a double free: the header then reads
+     * as freed, or as zero if the memory was truncated.
+     */
+    void generateFree(GenerationContext* gctx, Value* pointer) {
+        auto modelPointer = builder.CreatePtrToInt(vMap(gctx, pointer), t_intptr, "freePointer");
+        llvmgen::If2 genIf(builder, builder.CreateICmpNE(modelPointer, ConstantInt::get(t_intptr, 0)), "free_nonnull");
+        genIf.startTrue();
+        auto headerPointer = builder.CreateSub(modelPointer, ConstantInt::get(t_intptr, OBJECT_HEADER_SIZE));
+        auto header = generateLoad(gctx, headerPointer, t_int64);
+
+        // Double or invalid free
+        auto kind = builder.CreateAnd(builder.CreateLShr(header, ConstantInt::get(t_int64, 32)), ConstantInt::get(t_int64, 0xFF));
+        llvmgen::If2 genIfFreed(builder, builder.CreateICmpNE(kind, ConstantInt::get(t_int64, OBJECT_HEAP)), "free_invalid");
+        genIfFreed.startTrue();
+        builder.CreateStore(ConstantInt::get(t_int, GlobalStatus::ENDED_FAILURE), lts["status"].getValue(gctx->svout));
+        genIfFreed.endTrue();
+        genIfFreed.startFalse();
+
+        auto size = builder.CreateAnd(header, ConstantInt::get(t_int64, 0xFFFFFFFFULL));
+        auto zeroes = builder.CreateAlloca(t_char, size, "freed");
+        builder.CreateMemSet(zeroes, ConstantInt::get(t_int8, 0), size, MaybeAlign(1));
+        generateStore(gctx, modelPointer, zeroes, size);
+        generateStore(gctx, headerPointer, builder.CreateOr(size, ConstantInt::get(t_int64, (uint64_t)OBJECT_FREED << 32)), t_int64);
+
+        // Give the memory back if this is the last object
+        auto processorID = getCreatorProcessorIDOfPointer(modelPointer);
+        auto memorySize = builder.CreateLoad(t_int, lts["processes"][processorID]["msize"].getValue(gctx->svout));
+        auto end = builder.CreateAdd(getOffsetPartOfPointer(modelPointer), builder.CreateIntCast(size, t_intptr, false));
+        llvmgen::If2 genIfLast(builder, builder.CreateICmpEQ(end, builder.CreateIntCast(memorySize, t_intptr, false)), "free_last");
+        genIfLast.startTrue();
+        generateTruncateMemory(gctx, processorID, builder.CreateIntCast(getOffsetPartOfPointer(headerPointer), t_int, false));
+        genIfLast.endTrue();
+        genIfLast.finally();
+
+        genIfFreed.endFalse();
+        genIfFreed.finally();
+        genIf.endTrue();
+        genIf.finally();
+    }
+
+    /**
+     * @brief Sets the memory size of process @c processorID to
+     * @c memorySize, which must not be larger than the current size, and
+     * zeroes the released bytes of its memory chunk with a single delta.
+     * Memory that is released completely becomes the empty chunk, unless it
+     * is a big chunk.
+     */
+    void generateTruncateMemory(GenerationContext* gctx, Value* processorID, Value* memorySize) {
+        auto pMemorySize = lts["processes"][processorID]["msize"].getValue(gctx->svout);
+        auto pChunkMemory = lts["processes"][processorID]["m"].getValue(gctx->svout);
+        auto oldMemorySize = builder.CreateLoad(t_int, pMemorySize, "oldMemorySize");
+        builder.CreateStore(memorySize, pMemorySize);
+
+        // Paged memory drops the pages beyond the new size and zeroes the
+        // rest of the last page
+        if(_pagedMemory) {
+            auto f_truncate = llmcvm_func("llmc_paged_truncate", true);
+            auto t_truncate = f_truncate->getFunctionType();
+            auto newMem = builder.CreateCall(f_truncate, { builder.CreatePointerCast(gctx->userContext, t_truncate->getParamType(0))
+                                                         , builder.CreatePointerCast(f_vmGetChunk, t_truncate->getParamType(1))
+                                                         , builder.CreatePointerCast(f_vmPutChunk, t_truncate->getParamType(2))
+                                                         , builder.CreateLoad(t_chunkid, pChunkMemory, "chunkMemory")
+                                                         , builder.CreateIntCast(memorySize, t_truncate->getParamType(4), false)
+                                                         });
+            builder.CreateStore(newMem, pChunkMemory);
+            return;
+        }
+
+        // Split before the insertion point, or at the end of the block
+        Instruction* placeholder = nullptr;
+        if(builder.GetInsertPoint() == builder.GetInsertBlock()->end()) {
+            placeholder = builder.CreateUnreachable();
+            builder.SetInsertPoint(placeholder);
+        }
+        auto next = &*builder.GetInsertPoint();
+
+        // Only the part of the chunk up to the old size may hold nonzero
+        // bytes beyond the new size. The length of a big chunk is not known,
+        // so all of the released bytes are zeroed, using dmc_big_delta().
+        bool big = isBigChunkType(type_memory);
+        auto size = builder.CreateIntCast(memorySize, t_int64, false);
+        Value* end = builder.CreateIntCast(oldMemorySize, t_int64, false);
+        if(!big) {
+            auto length = builder.CreateIntCast(getLengthOfStateID(builder.CreateLoad(t_chunkid, pChunkMemory, "chunkMemory")), t_int64, false);
+            end = builder.CreateSelect(builder.CreateICmpULT(end, length), end, length);
+        }
+        builder.SetInsertPoint(SplitBlockAndInsertIfThen(builder.CreateICmpUGT(end, size), next, false));
+
+        // Zero the released bytes, or release the chunk completely
+        Instruction* truncate = &*builder.GetInsertPoint();
+        Instruction* release = nullptr;
+        if(!big) {
+            SplitBlockAndInsertIfThenElse(builder.CreateICmpNE(size, ConstantInt::get(size->getType(), 0)), truncate, &truncate, &release);
+        }
+        builder.SetInsertPoint(truncate);
+        auto released = builder.CreateSub(end, size);
+        auto zeroes = builder.CreateAlloca(t_char, released, "released");
+        builder.CreateMemSet(zeroes, ConstantInt::get(t_int8, 0), released, MaybeAlign(1));
+        generateMemoryWrite(gctx, pChunkMemory, memorySize, released, zeroes);
+        if(release) {
+            builder.SetInsertPoint(release);
+            builder.CreateStore(ConstantInt::get(t_chunkid, 0), pChunkMemory);
+        }
+
+        if(placeholder) {
+            auto BB = placeholder->getParent();
+            placeholder->eraseFromParent();
+            builder.SetInsertPoint(BB);
+        } else {
+            builder.SetInsertPoint(next);
+        }
+    }
+
     void generateNextStateForLoadInstruction(GenerationContext* gctx, LoadInst* I) {
     }
 
@@ -3054,7 +4984,7 @@ public:
      */
     Value* generateNextStateForMemoryInstruction(GenerationContext* gctx, LoadInst* I) {
         Value* ptr = I->getPointerOperand();
-        auto registers = lts["processes"][gctx->thread_id]["r"].getValue(gctx->svout);
+        auto registers = gctx->registers;
         Value* modelPtr = vGetMemOffset(gctx, registers, ptr);
         auto loadedValue = generateLoad(gctx, modelPtr, I->getType());
         builder.CreateStore(loadedValue, vReg(registers, I))->setAlignment(Align(1));
@@ -3062,7 +4992,7 @@ public:
     }
     Value* generateNextStateForMemoryInstruction(GenerationContext* gctx, StoreInst* I) {
         Value* ptr = I->getPointerOperand();
-        auto registers = lts["processes"][gctx->thread_id]["r"].getValue(gctx->svout);
+        auto registers = gctx->registers;
         Value* modelPtr = vGetMemOffset(gctx, registers, ptr);
         auto mappedValue = vMap(gctx, I->getValueOperand());
         generateStore(gctx, modelPtr, mappedValue, I->getValueOperand()->getType());
@@ -3232,6 +5162,59 @@ public:
         builder.SetInsertPoint(If.getFinal());
     }
 
+    /**
+     * @brief Generates the call of the function pointer called by @c I.
+     *
+     * A function pointer is the program location of the entry of the
+     * function. If the function type of the call has few possible targets,
+     * a switch over their locations pushes the frame of the matching target,
+     * such that its parameters and entry location are known at generation
+     * time. Other locations, e.g. of a function called via a cast to a
+     * different function type, push a frame using only the function type.
+     */
+    void generateIndirectCall(GenerationContext* gctx, CallInst* I) {
+        indirectCalls++;
+        auto fValue = vMap(gctx, I->getCalledOperand());
+        fValue = builder.CreatePtrToInt(fValue, t_intptr);
+
+        std::vector<Value*> args;
+        for(unsigned int i=0; i < I->getNumArgOperands(); ++i) {
+            args.push_back(I->getArgOperand(i));
+        }
+
+        auto generatePushUsingType = [&]() {
+            std::vector<Value*> argValues;
+            for(auto arg: args) {
+                argValues.push_back(vMap(gctx, arg));
+            }
+            stack.pushStackFrame(gctx, I->getFunctionType(), fValue, argValues, I);
+        };
+
+        auto it = indirectCallTargets.find(getIndirectCallKey(I->getFunctionType()));
+        if(it == indirectCallTargets.end() || it->second.size() > MAX_INDIRECT_CALL_TARGETS) {
+            generatePushUsingType();
+            return;
+        }
+        indirectCallsDispatched++;
+
+        auto F = builder.GetInsertBlock()->getParent();
+        auto BBEnd = BasicBlock::Create(ctx, "indirect_call_end", F);
+        auto BBUnknown = BasicBlock::Create(ctx, "indirect_call_unknown", F);
+        auto location = builder.CreateIntCast(fValue, t_int, false);
+        auto swtch = builder.CreateSwitch(location, BBUnknown, it->second.size());
+        for(auto target: it->second) {
+            auto BB = BasicBlock::Create(ctx, "indirect_call_" + target->getName(), F, BBUnknown);
+            swtch->addCase(ConstantInt::get(t_int, programLocations[&*target->getEntryBlock().begin()]), BB);
+            builder.SetInsertPoint(BB);
+            stack.pushStackFrame(gctx, *target, args, I);
+            builder.CreateBr(BBEnd);
+        }
+        builder.SetInsertPoint(BBUnknown);
+        generatePushUsingType();
+        builder.CreateBr(BBEnd);
+        builder.SetInsertPoint(BBEnd);
+    }
+
     /**
      * @brief Generates the next-state relation for the CallInst @c I
      *
@@ -3275,24 +5258,7 @@ public:
             // thus we need to handle it differently.
             Function* F = I->getCalledFunction();
             if(!F) {
-                string ftype;
-                raw_string_ostream ftype_stream(ftype);
-                ftype_stream << *I->getFunctionType();
-//                out.reportNote("Handling function call to unknown function " + ftype_stream.str());
-                auto fValue = vMap(gctx, I->getCalledOperand());
-                fValue = builder.CreatePtrToInt(fValue, t_intptr);
-
-                builder.CreateCall( pins("printf")
-                        , { generateGlobalString("CALLING FUNCTION %u\n")
-                                            , fValue
-                                    }
-                );
-
-                std::vector<Value*> args;
-                for(unsigned int i=0; i < I->getNumArgOperands(); ++i) {
-                    args.push_back(vMap(gctx, I->getArgOperand(i)));
-                }
-                stack.pushStackFrame(gctx, I->getFunctionType(), fValue, args, I);
+                generateIndirectCall(gctx, I);
             } else if(F->isDeclaration()) {
 
 //                auto it = gctx->gen->hookedFunctions.find(F->getName().str());
@@ -3373,19 +5339,24 @@ public:
                     // TODO: we can use pushStackFrame to simulate a real memcpy
 
                     if(F->getName().startswith("llvm.memcpy")) {
-                        auto registers = lts["processes"][gctx->thread_id]["r"].getValue(gctx->svout);
+                        auto registers = gctx->registers;
                         Value* dst = vGetMemOffset(gctx, registers, I->getArgOperand(0));
                         Value* src = vGetMemOffset(gctx, registers, I->getArgOperand(1));
                         Value* size = vMap(gctx, I->getArgOperand(2));
 //                        Value* isVolatile = vMap(gctx, I->getArgOperand(3));
                         auto storage = generateAccessToMemory(gctx, src, size); //TODO: align using src/dst?
                         generateStore(gctx, dst, storage, size);
+                    } else if(F->getName().startswith("llvm.masked.") || F->getName().startswith("llvm.vector.reduce.")) {
+
+                        // These access memory or compute a result, so ignoring
+                        // them like other intrinsics would be wrong
+                        out.reportError("Vector intrinsic is not supported: " + F->getName().str());
                     }
                 } else if(F->getName().equals("__atomic_load")) {
 
                     // void __atomic_load (type *ptr, type *ret, int memorder)
                     // Basically this does *ret = *ptr;
-                    auto registers = lts["processes"][gctx->thread_id]["r"].getValue(gctx->svout);
+                    auto registers = gctx->registers;
 
                     Value* size;
                     Value* ptr;
@@ -3435,7 +5406,7 @@ public:
 
                 } else if(F->getName().equals("__atomic_store")) {
 
-                    auto registers = lts["processes"][gctx->thread_id]["r"].getValue(gctx->svout);
+                    auto registers = gctx->registers;
                     // void __atomic_store (type *ptr, type *val, int memorder)
                     // Basically this does *ptr = *val;
 
@@ -3477,7 +5448,7 @@ public:
                     // bool __atomic_compare_exchange(size_t size, void *ptr, void *expected, void *desired,            int success_order,    int failure_order   )
                     // bool __atomic_compare_exchange(             type *ptr, type *expected, type *desired, bool weak, int success_memorder, int failure_memorder)
 
-                    auto registers = lts["processes"][gctx->thread_id]["r"].getValue(gctx->svout);
+                    auto registers = gctx->registers;
 
                     Value* size;
                     Value* ptr;
@@ -3507,64 +5478,87 @@ public:
 //                    Value* memorder_success = vMap(gctx, I->getArgOperand(4));
 //                    Value* memorder_failure = vMap(gctx, I->getArgOperand(5));
 
-                    auto storagePtr = generateAccessToMemory(gctx, ptr, size);
-                    auto storageExpected = generateAccessToMemory(gctx, expected, size);
-                    auto storageDesired = generateAccessToMemory(gctx, desired, size);
+                    // Operands of 1, 2, 4, 8 or 16 bytes are compared and
+                    // swapped as an integer directly on the memory chunk
+                    auto constantSize = dyn_cast<ConstantInt>(size);
+                    if(constantSize && isPowerOf2_64(constantSize->getZExtValue()) && constantSize->getZExtValue() <= 16) {
+                        auto t_operand = IntegerType::get(ctx, constantSize->getZExtValue() * 8);
+                        auto expectedValue = generateLoad(gctx, expected, t_operand);
+                        auto desiredValue = generateLoad(gctx, desired, t_operand);
+                        Value* loaded;
+                        auto success = generateCompareAndSwap(gctx, ptr, expectedValue, desiredValue, loaded);
+                        builder.CreateStore(success, vReg(registers, I));
+
+                        // On failure, the value that was found is written to *expected
+                        llvmgen::If genIf(builder, "__atomic_compare_exchange_failed");
+                        genIf.setCond(builder.CreateNot(success));
+                        auto bbTrue = genIf.getTrue();
+                        genIf.generate();
+                        builder.SetInsertPoint(&*bbTrue->getFirstInsertionPt());
+                        auto storageLoaded = addAlloca(t_operand, builder.GetInsertBlock()->getParent());
+                        builder.CreateStore(loaded, storageLoaded)->setAlignment(Align(1));
+                        generateStore(gctx, expected, storageLoaded, generateSizeOf(t_operand));
+                        builder.SetInsertPoint(genIf.getFinal());
+                    } else {
+                        auto storagePtr = generateAccessToMemory(gctx, ptr, size);
+                        auto storageExpected = generateAccessToMemory(gctx, expected, size);
+                        auto storageDesired = generateAccessToMemory(gctx, desired, size);
 
-//                    auto loadedPtr = builder.CreateLoad(storagePtr);
-//                    auto loadedExpected = builder.CreateLoad(storageExpected);
-//                    auto loadedDesired = builder.CreateLoad(storageDesired);
+//                        auto loadedPtr = builder.CreateLoad(storagePtr);
+//                        auto loadedExpected = builder.CreateLoad(storageExpected);
+//                        auto loadedDesired = builder.CreateLoad(storageDesired);
 
-                    Value* resultReg = vReg(registers, I);
-//                    auto cmp = builder.CreateICmpEQ(loadedPtr, loadedExpected);
-                    Value* cmp = builder.CreateCall(llmcvm_func("__LLMCOS_memcmp"), { storagePtr, storageExpected, size});
-                    cmp = builder.CreateICmpEQ(cmp, ConstantInt::get(cmp->getType(), 0));
+                        Value* resultReg = vReg(registers, I);
+//                        auto cmp = builder.CreateICmpEQ(loadedPtr, loadedExpected);
+                        Value* cmp = builder.CreateCall(llmcvm_func("__LLMCOS_memcmp"), { storagePtr, storageExpected, size});
+                        cmp = builder.CreateICmpEQ(cmp, ConstantInt::get(cmp->getType(), 0));
 
-                    llvmgen::If genIf(builder, "__atomic_compare_exchange");
+                        llvmgen::If genIf(builder, "__atomic_compare_exchange");
 
-                    genIf.setCond(cmp);
-                    auto bbTrue = genIf.getTrue();
-                    auto bbFalse = genIf.getFalse();
-                    genIf.generate();
+                        genIf.setCond(cmp);
+                        auto bbTrue = genIf.getTrue();
+                        auto bbFalse = genIf.getFalse();
+                        genIf.generate();
 
-                    builder.SetInsertPoint(&*bbTrue->getFirstInsertionPt());
+                        builder.SetInsertPoint(&*bbTrue->getFirstInsertionPt());
 
-                    generateStore(gctx, ptr, storageDesired, size);
-                    builder.CreateStore(ConstantInt::get(t_bool, 1), resultReg);
-//                    builder.CreateCall( pins("printf")
-//                            , { generateGlobalString("__atomic_compare_exchange %p %p %p %u: success\n")
-//                                                , ptr
-//                                                , expected
-//                                                , desired
-//                                                , size
-//                                        }
-//                    );
+                        generateStore(gctx, ptr, storageDesired, size);
+                        builder.CreateStore(ConstantInt::get(t_bool, 1), resultReg);
+//                        builder.CreateCall( pins("printf")
+//                                , { generateGlobalString("__atomic_compare_exchange %p %p %p %u: success\n")
+//                                                    , ptr
+//                                                    , expected
+//                                                    , desired
+//                                                    , size
+//                                            }
+//                        );
 
-                    builder.SetInsertPoint(&*bbFalse->getFirstInsertionPt());
+                        builder.SetInsertPoint(&*bbFalse->getFirstInsertionPt());
 
-                    generateStore(gctx, expected, storagePtr, size);
-                    builder.CreateStore(ConstantInt::get(t_bool, 0), resultReg);
-//                    builder.CreateCall( pins("printf")
-//                            , { generateGlobalString("__atomic_compare_exchange %p %p %p %u: failure\n")
-//                                                , ptr
-//                                                , expected
-//                                                , desired
-//                                                , size
-//                                        }
-//                    );
+                        generateStore(gctx, expected, storagePtr, size);
+                        builder.CreateStore(ConstantInt::get(t_bool, 0), resultReg);
+//                        builder.CreateCall( pins("printf")
+//                                , { generateGlobalString("__atomic_compare_exchange %p %p %p %u: failure\n")
+//                                                    , ptr
+//                                                    , expected
+//                                                    , desired
+//                                                    , size
+//                                            }
+//                        );
 
-                    builder.SetInsertPoint(genIf.getFinal());
+                        builder.SetInsertPoint(genIf.getFinal());
+                    }
 
                 } else if(F->getName().equals("malloc")) { // __LLMCOS_Object_New
 
-                    auto registers = lts["processes"][gctx->thread_id]["r"].getValue(gctx->svout);
+                    auto registers = gctx->registers;
 //                    Heap heap(gctx, gctx->svout);
                     Value* bytes = I->getArgOperand(0);
 //                    roout << "bytes: " << *bytes << "\n";
 //                    roout.flush();
 //                    Value* offset = heap.malloc(vMap(gctx, bytes));
 //                    heap.upload();
-                    Value* offset = generateAllocateMemory(gctx, vMap(gctx, bytes));
+                    Value* offset = generateAllocateObject(gctx, vMap(gctx, bytes), OBJECT_HEAP, getAllocationSite(I));
 //                    auto offsetOld = offset;
                     offset = gctx->gen->builder.CreateIntCast(offset, t_intptr, false);
                     offset = gctx->gen->builder.CreateIntToPtr(offset, I->getType());
@@ -3576,6 +5570,9 @@ public:
 //                    );
                     builder.CreateStore(offset, vReg(registers, I))->setAlignment(Align(1));
 
+                } else if(F->getName().equals("free")) { // __LLMCOS_Object_Free
+                    generateFree(gctx, I->getArgOperand(0));
+
                 } else if(F->getName().equals("__LLMCOS_Object_CheckAccess")) {
                 } else if(F->getName().equals("__LLMCOS_Object_CheckNotOverlapping")) {
                 } else if(F->getName().equals("__LLMCOS_Fatal")) {
@@ -3594,7 +5591,7 @@ public:
 
                     // For every thread position, generate code that checks if it is
                     // free. If so, put the new thread there. Else, continue.
-                    for(int tIdx = 0; tIdx < MAX_THREADS; ++tIdx) {
+                    for(int tIdx = 0; tIdx < maxThreads; ++tIdx) {
 
                         // Check that PC == 0
                         auto pc = lts["processes"][tIdx]["pc"].getValue(gctx->svout);
@@ -3644,7 +5641,7 @@ public:
                         //auto sv_memorydata = cm_memory.generateGetAndCopy(chunkMemory, sv_memorylen);
 
                         // Store the thread ID in the program (pthread_t)
-                        auto registers = lts["processes"][gctx->thread_id]["r"].getValue(gctx->svout);
+                        auto registers = gctx->registers;
 
 //                        auto tid_p_in_program = vMapPointer(gctx, registers, sv_memorydata, I->getArgOperand(0), t_int64p);
 //                        builder.CreateStore( builder.CreateIntCast(threadsStarted, t_int64, false)
@@ -3686,7 +5683,7 @@ public:
                 } else if(F->getName().equals("pthread_join")) { // __LLMCOS_Thread_Join
                     // int pthread_join(pthread_t thread, void **value_ptr);
 
-                    auto registers = lts["processes"][gctx->thread_id]["r"].getValue(gctx->svout);
+                    auto registers = gctx->registers;
 
                     // Return 0
                     auto returnRegister = vReg(registers, *I->getParent()->getParent(), "pthread_join_return_register", I);
@@ -3789,7 +5786,7 @@ public:
 
     void generateStoresForPHINodes(GenerationContext* gctx, BasicBlock* from, BasicBlock* to) {
         BasicBlock* const& currentBlock = from;
-        auto dst_reg = lts["processes"][gctx->thread_id]["r"].getValue(gctx->svout);
+        auto dst_reg = gctx->registers;
 
         std::unordered_map<PHINode*, std::vector<PHINode*>> dependencies;
 
@@ -3844,6 +5841,7 @@ public:
                     auto phiValue = phiNode->getIncomingValueForBlock(currentBlock);
                     auto phiRegister = vReg(dst_reg, phiNode);
                     auto c = builder.CreateStore(vMap(gctx, phiValue), phiRegister);
+                    c->setAlignment(Align(1));
                     setDebugLocation(c, __FILE__, __LINE__);
 
                     string sPhiValue;
@@ -3897,6 +5895,68 @@ public:
         assert(dependencies.size() == 0);
     }
 
+    /**
+     * @brief Returns whether @c I is a call that pushes a new frame for the
+     * callee, as opposed to a call that is handled by the generator.
+     */
+    bool pushesStackFrame(Instruction* I) {
+        auto call = dyn_cast<CallInst>(I);
+        if(!call || call->isInlineAsm()) return false;
+        Function* F = call->getCalledFunction();
+        return !F || !F->isDeclaration();
+    }
+
+    /**
+     * @brief The number of bytes of the registers of the caller that need to
+     * be saved in the register frame of @c callSite: up to and including the
+     * last register that is live across the call. The result register of the
+     * call is written on return, so it is not saved.
+     */
+    size_t getLiveRegisterFrameSize(CallInst* callSite) {
+        auto F = callSite->getFunction();
+        auto& liveness = getRegisterLiveness(F);
+        auto const& live = liveness.liveAt(callSite->getNextNode());
+        auto const& registers = liveness.getRegisters();
+        auto layout = dmcModule->getDataLayout().getStructLayout(cast<StructType>(registerLayout[F].registerLayout));
+        size_t size = 0;
+        for(size_t idx = 0; idx < registers.size(); ++idx) {
+            if(!live.test(idx) || registers[idx] == callSite) continue;
+            auto elementIdx = valueRegisterIndex[registers[idx]];
+            auto end = layout->getElementOffset(elementIdx)
+                     + dmcModule->getDataLayout().getTypeAllocSize(registers[idx]->getType());
+            size = std::max<size_t>(size, end);
+        }
+        return (size + 3) & ~(size_t)3;
+    }
+
+    RegisterLiveness& getRegisterLiveness(Function* F) {
+        auto& liveness = registerLiveness[F];
+        if(!liveness) {
+            liveness = std::make_unique<RegisterLiveness>(*F);
+        }
+        return *liveness;
+    }
+
+    /**
+     * @brief Generates stores of 0 to the registers that are dead right
+     * before @c at executes.
+     * @param at The instruction the process continues with
+     * @param redefined A register that is live at @c at, but of which the
+     * current value is not needed, because it is about to be written
+     */
+    void generateZeroingOfDeadRegisters(GenerationContext* gctx, Instruction* at, Value* redefined = nullptr) {
+        auto& liveness = getRegisterLiveness(at->getFunction());
+        auto const& live = liveness.liveAt(at);
+        auto const& registers = liveness.getRegisters();
+        auto dst_reg = gctx->registers;
+        for(size_t idx = 0; idx < registers.size(); ++idx) {
+            if(live.test(idx) && registers[idx] != redefined) continue;
+            builder.CreateStore(Constant::getNullValue(registers[idx]->getType()), vReg(dst_reg, registers[idx]))->setAlignment(Align(1));
+            zeroedRegisters++;
+        }
+        zeroingPoints++;
+    }
+
     Value* generateNextStateForInstruction(GenerationContext* gctx, BranchInst* I) {
         auto dst_pc = lts["processes"][gctx->thread_id]["pc"].getValue(gctx->svout);
 
@@ -3940,6 +6000,9 @@ public:
 //                                   }
 //                );
                 generateStoresForPHINodes(gctx, I->getParent(), I->getSuccessor(0));
+                if(_zeroDeadRegisters) {
+                    generateZeroingOfDeadRegisters(gctx, &*I->getSuccessor(0)->begin());
+                }
 
                 builder.SetInsertPoint(&*bbFalse->getFirstInsertionPt());
 //                builder.CreateCall(pins("printf"), { generateGlobalString("[branch inst] Branching to FALSE case: %s\n")
@@ -3947,6 +6010,9 @@ public:
 //                                   }
 //                );
                 generateStoresForPHINodes(gctx, I->getParent(), I->getSuccessor(1));
+                if(_zeroDeadRegisters) {
+                    generateZeroingOfDeadRegisters(gctx, &*I->getSuccessor(1)->begin());
+                }
 
                 builder.SetInsertPoint(genIf.getFinal());
             } else {
@@ -3955,11 +6021,7 @@ public:
             }
         } else {
             if(I->getNumSuccessors() == 1) {
-                auto loc = gctx->gen->programLocations[&*I->getSuccessor(0)->begin()];
-                assert(loc);
-                auto s = gctx->gen->builder.CreateStore(ConstantInt::get(gctx->gen->t_int, loc), dst_pc);
-                setDebugLocation(s, __FILE__, __LINE__);
-                generateStoresForPHINodes(gctx, I->getParent(), I->getSuccessor(0));
+                generateJump(gctx, I->getParent(), I->getSuccessor(0));
             } else {
                 roout << "Unconditional branch has more or less than 1 successor: " << *I << "\n";
                 roout.flush();
@@ -3969,6 +6031,62 @@ public:
         return nullptr;
     }
 
+    /**
+     * @brief Generates the jump along the edge from the basic block @c from
+     * to the basic block @c to: sets the program counter to the start of
+     * @c to and assigns the PHI nodes of @c to.
+     */
+    void generateJump(GenerationContext* gctx, BasicBlock* from, BasicBlock* to) {
+        auto dst_pc = lts["processes"][gctx->thread_id]["pc"].getValue(gctx->svout);
+        auto loc = programLocations[&*to->begin()];
+        assert(loc);
+        auto s = builder.CreateStore(ConstantInt::get(t_int, loc), dst_pc);
+        setDebugLocation(s, __FILE__, __LINE__);
+        generateStoresForPHINodes(gctx, from, to);
+        if(_zeroDeadRegisters) {
+            generateZeroingOfDeadRegisters(gctx, &*to->begin());
+        }
+    }
+
+    /**
+     * @brief Generates the next-state relation for the SwitchInst @c I
+     *
+     * The switch is kept as a switch in the generated code, with a block per
+     * distinct successor that jumps to it, so the PHI nodes are assigned per
+     * edge. Cases with the same successor share that block.
+     */
+    Value* generateNextStateForInstruction(GenerationContext* gctx, SwitchInst* I) {
+        auto F = builder.GetInsertBlock()->getParent();
+        auto BBEnd = BasicBlock::Create(ctx, "switch_end", F);
+
+        std::vector<std::pair<BasicBlock*, BasicBlock*>> edges;
+        std::unordered_map<BasicBlock*, BasicBlock*> edgeBlocks;
+        auto getEdgeBlock = [&](BasicBlock* to) {
+            auto& BB = edgeBlocks[to];
+            if(!BB) {
+                BB = BasicBlock::Create(ctx, "switch_to_" + to->getName(), F, BBEnd);
+                edges.push_back({to, BB});
+            }
+            return BB;
+        };
+
+        auto swtch = builder.CreateSwitch( vMap(gctx, I->getCondition())
+                                         , getEdgeBlock(I->getDefaultDest())
+                                         , I->getNumCases()
+                                         );
+        for(auto& c: I->cases()) {
+            swtch->addCase(c.getCaseValue(), getEdgeBlock(c.getCaseSuccessor()));
+        }
+
+        for(auto& edge: edges) {
+            builder.SetInsertPoint(edge.second);
+            generateJump(gctx, I->getParent(), edge.first);
+            builder.CreateBr(BBEnd);
+        }
+        builder.SetInsertPoint(BBEnd);
+        return nullptr;
+    }
+
     void printLocation(std::string const& file, size_t line) {
         builder.CreateCall( pins("printf")
                           , { generateGlobalString("now at %s:%u\n")
@@ -4022,7 +6140,7 @@ public:
 
                 // Init stack
 //                builder.CreateCall(pins("printf"), {generateGlobalString("Setting up initial stack\n")});
-                for(size_t threadID = 0; threadID < MAX_THREADS; ++threadID) {
+                for(int threadID = 0; threadID < maxThreads; ++threadID) {
                     auto pStackChunkID = lts["processes"][threadID]["stk"].getValue(s_statevector);
                     builder.CreateStore(stack.getEmptyStack(&gctx), pStackChunkID);
                 }
@@ -4090,8 +6208,7 @@ public:
 //                builder.CreateCall(pins("printf"), {generateGlobalString("Storing globals into memory, size %u\n"), globalsSize});
 //                ChunkMapper cm_memory(&gctx, type_memory);
 //                auto newMemory = cm_memory.generatePut(globalsSize, globalsInit);
-                StateManager sm_memory(gctx.userContext, this, type_memory);
-                auto newMemory = sm_memory.uploadBytes(globalsInit, globalsSize);
+                auto newMemory = generateMemoryUpload(gctx.userContext, globalsInit, globalsSize);
                 builder.CreateStore(newMemory, lts["processes"][0]["m"].getValue(s_statevector));
                 auto memorySize = lts["processes"][0]["msize"].getValue(s_statevector);
                 builder.CreateStore(globalsSize, memorySize);
@@ -4126,7 +6243,93 @@ public:
 
     }
 
+    /**
+     * @brief Folds @c v to a constant integer using the data layout, e.g. the
+     * result of generateSizeOf(). Returns nullptr if @c v is not constant.
+     */
+    ConstantInt* foldToConstantInt(Value* v) {
+        auto C = dyn_cast<Constant>(v);
+        if(!C) return nullptr;
+        if(isa<ConstantExpr>(C)) {
+            C = ConstantFoldConstant(C, dmcModule->getDataLayout());
+        }
+        return dyn_cast_or_null<ConstantInt>(C);
+    }
+
+    /**
+     * @brief Tries to prove that the integer or pointer @c v is a multiple of
+     * @c multipleOf, which must be a power of 2. Nothing is proven when
+     * checks are disabled.
+     */
+    CheckProof proveIsMultipleOf(Value* v, uint64_t multipleOf) {
+        assert(isPowerOf2_64(multipleOf));
+        if(checks == Checks::None) {
+            return CheckProof::Unknown;
+        }
+        if(auto c = foldToConstantInt(v)) {
+            return (c->getZExtValue() & (multipleOf - 1)) ? CheckProof::Fails : CheckProof::Holds;
+        }
+        if(v->getType()->isIntOrPtrTy()) {
+            auto known = computeKnownBits(v, dmcModule->getDataLayout());
+            if(known.countMinTrailingZeros() >= Log2_64(multipleOf)) {
+                return CheckProof::Holds;
+            }
+        }
+        return CheckProof::Unknown;
+    }
+
+    /**
+     * @brief Tries to prove that [ptr, ptr+size) lies within
+     * [range_start, range_start+range_size). This succeeds if both sizes are
+     * constant and @c ptr is a constant offset from @c range_start. Nothing
+     * is proven when checks are disabled.
+     */
+    CheckProof proveIsInRange(Value* ptr, Value* size, Value* range_start, Value* range_size) {
+        if(checks == Checks::None) {
+            return CheckProof::Unknown;
+        }
+        auto cSize = foldToConstantInt(size);
+        auto cRangeSize = foldToConstantInt(range_size);
+        if(!cSize || !cRangeSize) {
+            return CheckProof::Unknown;
+        }
+        int64_t offset = 0;
+        auto base = GetPointerBaseWithConstantOffset(ptr, offset, dmcModule->getDataLayout());
+        if(base->stripPointerCasts() != range_start->stripPointerCasts()) {
+            return CheckProof::Unknown;
+        }
+        if(offset < 0 || (uint64_t)offset + cSize->getZExtValue() > cRangeSize->getZExtValue()) {
+            return CheckProof::Fails;
+        }
+        return CheckProof::Holds;
+    }
+
+    /**
+     * @brief Returns whether a runtime check with the outcome @c proof of the
+     * generation time proof needs to be generated, according to the Checks
+     * mode, and keeps track of the number of elided checks.
+     * @param what Description of the check, used when it always fails
+     */
+    bool needsRuntimeCheck(CheckProof proof, std::string const& what) {
+        if(proof == CheckProof::Fails) {
+            out.reportWarning("Runtime check always fails: " + what);
+        }
+        bool needed = checks == Checks::Full || (checks == Checks::Static && proof == CheckProof::Fails);
+        if(needed) {
+            checksEmitted++;
+        } else {
+            checksElided++;
+            if(proof == CheckProof::Holds) {
+                checksProven++;
+            }
+        }
+        return needed;
+    }
+
     void generateBoundCheck(Value* ptr, Value* size, Value* range_start, Value* range_size) {
+        if(!needsRuntimeCheck(proveIsInRange(ptr, size, range_start, range_size), "range check")) {
+            return;
+        }
         auto f = pins("__LLMCOS_CheckRangeIsInRange");
         builder.CreateCall(f, {
                 builder.CreatePointerCast(ptr, f->getFunctionType()->getParamType(0))
@@ -4495,6 +6698,27 @@ public:
         dmcModule->print(fdout, nullptr);
     }
 
+    /**
+     * @brief Links the LLMC VM into the generated model and hands the
+     * result to the caller. This takes the place of linking against
+     * libllmcvm.a when the model is compiled in-process. The generator
+     * no longer owns the model afterwards.
+     * @return The linked model, or nullptr on failure.
+     */
+    std::unique_ptr<Module> releaseModule() {
+        std::unique_ptr<Module> m(dmcModule);
+        dmcModule = nullptr;
+        if(!m) {
+            return m;
+        }
+        llvm::Linker linker(*m);
+        if(linker.linkInModule(std::move(up_libllmcvmModule), Linker::Flags::LinkOnlyNeeded)) {
+            out.reportError("Failed to link LLMC VM into the model");
+            return std::unique_ptr<Module>(nullptr);
+        }
+        return m;
+    }
+
     /**
      * @brief Generates a global const char[] for the string @c s.
      * @param s The string to generate a global const char[] for.
@@ -0,0 +1,92 @@
+/*
+ * LLMC - LLVM IR Model Checker
+ * Copyright © 2013-2021 Freark van der Berg
+ *
+ * This file is part of LLMC.
+ *
+ * LLMC is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * LLMC is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LLMC.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include <libfrugi/MessageFormatter.h>
+#include <llvm/ExecutionEngine/Orc/LLJIT.h>
+#include <llvm/ExecutionEngine/Orc/ThreadSafeModule.h>
+
+namespace llmc {
+
+using namespace libfrugi;
+
+/**
+ * @class ModelJIT
+ * @file ModelJIT.h
+ * @brief Compiles a generated DMC model in-process using ORC, as an
+ * alternative to writing it to disk and running llc and cc on it.
+ * Symbols the model does not define itself, i.e. the DMC API and libc,
+ * are resolved against the running process.
+ */
+class ModelJIT {
+public:
+
+    ModelJIT(MessageFormatter& out);
+
+    /**
+     * @brief Runs the destructors of the model, if its constructors ran.
+     */
+    ~ModelJIT();
+
+    /**
+     * @brief Adds the model module @c tsm to the JIT. The JIT is created
+     * on the first call, using the data layout of the model.
+     * @return false on failure.
+     */
+    bool addModule(llvm::orc::ThreadSafeModule tsm);
+
+    /**
+     * @brief Runs the constructors of the added modules, like those of the
+     * LLMC VM. Must be called after addModule() and before the model is used.
+     * @return false on failure.
+     */
+    bool initialize();
+
+    /**
+     * @brief Runs the destructors of the added modules, like the ones of the
+     * LLMC VM that report its statistics. Does nothing if initialize() did
+     * not succeed or if this already happened.
+     */
+    void deinitialize();
+
+    /**
+     * @brief Looks up the symbol @c name, compiling its module if needed.
+     * @return The address of the symbol, or nullptr on failure.
+     */
+    void* lookup(std::string const& name);
+
+    template<typename T>
+    T lookup(std::string const& name) {
+        return reinterpret_cast<T>(lookup(name));
+    }
+
+private:
+    bool reportIfError(llvm::Error err, std::string const& what);
+
+private:
+    std::unique_ptr<llvm::orc::LLJIT> _jit;
+    MessageFormatter& _out;
+    bool _initialized;
+};
+
+} // namespace llmc
@@ -0,0 +1,96 @@
+/*
+ * LLMC - LLVM IR Model Checker
+ * Copyright © 2013-2021 Freark van der Berg
+ *
+ * This file is part of LLMC.
+ *
+ * LLMC is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * LLMC is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LLMC.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/Module.h>
+
+namespace llmc {
+
+using namespace llvm;
+
+/**
+ * @class EscapeAnalysis
+ * @file Escape.h
+ * @brief Decides which loads and stores access memory that no other process
+ * can access at the time of the access.
+ *
+ * Per function, the provenance of every pointer is computed: the set of
+ * allocas and malloc calls (allocation sites) it may point into, or unknown.
+ * Pointers stored in a slot, an alloca that is only loaded from and stored
+ * to directly, keep their provenance when loaded again. This is what makes
+ * the analysis useful on unoptimized code.
+ *
+ * A use of a pointer is an escape if it may make the address available to
+ * another process or to code this analysis does not follow: storing it
+ * anywhere but in a slot, passing it to a call, returning it, converting it
+ * to an integer, and so on. An access is thread-local if all objects it may
+ * access are allocation sites of the function and no escape of any of those
+ * objects can be executed before the access. That is, objects are
+ * thread-local until they are published.
+ */
+class EscapeAnalysis {
+public:
+    EscapeAnalysis(Module& module);
+    ~EscapeAnalysis();
+
+    /**
+     * @brief Returns whether @c I is a non-atomic, non-volatile load or
+     * store of memory that no other process can access at that point.
+     */
+    bool isThreadLocalAccess(Instruction* I);
+
+    /**
+     * @brief Returns whether the memory @c pointer points to cannot be
+     * accessed by other processes when @c I is executed.
+     */
+    bool isThreadLocal(Instruction* I, Value* pointer);
+
+private:
+    struct Provenance {
+        bool unknown = false;
+        std::unordered_set<Value*> objects;
+
+        bool add(Provenance const& other);
+    };
+
+    struct FunctionInfo {
+        std::unordered_map<Value*, Provenance> provenance;
+        std::unordered_map<Value*, std::vector<Instruction*>> escapes;
+    };
+
+    static bool isSlot(Value* V);
+    static bool isEscapingUse(Instruction* I, unsigned operand);
+
+    FunctionInfo& getInfo(Function* F);
+    Provenance provenanceOf(FunctionInfo& info, Value* V);
+    Provenance transfer(FunctionInfo& info, Instruction* I);
+
+private:
+    Module& _module;
+    std::unordered_map<Function*, std::unique_ptr<FunctionInfo>> _functions;
+};
+
+} // namespace llmc
@@ -0,0 +1,103 @@
+/*
+ * LLMC - LLVM IR Model Checker
+ * Copyright © 2013-2021 Freark van der Berg
+ *
+ * This file is part of LLMC.
+ *
+ * LLMC is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * LLMC is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LLMC.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <unordered_map>
+#include <unordered_set>
+
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/Module.h>
+
+namespace llmc {
+
+using namespace llvm;
+
+class EscapeAnalysis;
+
+/**
+ * @brief The memory a sequence of instructions may read and write.
+ * Objects are identified by the instruction or global that creates them:
+ * a GlobalVariable, an AllocaInst or the call to malloc (the allocation
+ * site). If an instruction accesses memory that cannot be attributed to a
+ * single object, or synchronizes with other processes in some other way,
+ * the footprint is opaque.
+ */
+struct Footprint {
+    std::unordered_set<Value*> reads;
+    std::unordered_set<Value*> writes;
+    bool opaque = false;
+};
+
+/**
+ * @class FootprintAnalysis
+ * @file Footprint.h
+ * @brief Computes conservative memory footprints of instructions and decides
+ * whether a footprint is independent of everything other processes can do.
+ *
+ * An object is thread-local if it is an alloca or a malloc'd object whose
+ * address never escapes: it is only loaded from, stored to or compared,
+ * possibly via GEPs, casts, PHIs and selects. A global is read-only if it is
+ * constant or never written to. A footprint is independent if it is not
+ * opaque, it writes only to thread-local objects and it reads only from
+ * thread-local or read-only objects. If an EscapeAnalysis is given, loads
+ * and stores it considers thread-local are left out of footprints.
+ */
+class FootprintAnalysis {
+public:
+    FootprintAnalysis(Module& module, EscapeAnalysis* escape = nullptr);
+
+    /**
+     * @brief Adds the accesses of @c I to @c fp.
+     */
+    void add(Instruction* I, Footprint& fp);
+
+    /**
+     * @brief Returns whether no process other than the executing one can
+     * observe or influence the accesses described by @c fp.
+     */
+    bool isIndependent(Footprint const& fp);
+
+    /**
+     * @brief Returns whether @c object is an alloca or a malloc'd object of
+     * which the address never escapes the creating process.
+     */
+    bool isThreadLocal(Value* object);
+
+    /**
+     * @brief Returns whether @c object is a global that is never written.
+     */
+    bool isReadOnly(Value* object);
+
+    static bool isAllocationSite(Value* V);
+
+private:
+    Value* objectOf(Value* pointer);
+    void addRead(Value* pointer, Footprint& fp);
+    void addWrite(Value* pointer, Footprint& fp);
+    bool onlyAccessed(Value* object, bool allowStores);
+
+private:
+    Module& _module;
+    EscapeAnalysis* _escape;
+    std::unordered_map<Value*, bool> _threadLocal;
+    std::unordered_map<Value*, bool> _readOnly;
+};
+
+} // namespace llmc
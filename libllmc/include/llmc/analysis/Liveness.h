@@ -0,0 +1,79 @@
+/*
+ * LLMC - LLVM IR Model Checker
+ * Copyright © 2013-2021 Freark van der Berg
+ *
+ * This file is part of LLMC.
+ *
+ * LLMC is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * LLMC is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LLMC.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cassert>
+#include <unordered_map>
+#include <vector>
+
+#include <llvm/ADT/BitVector.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/Instructions.h>
+
+namespace llmc {
+
+using namespace llvm;
+
+/**
+ * @class RegisterLiveness
+ * @file Liveness.h
+ * @brief Computes which registers of a function are live at every
+ * instruction.
+ *
+ * The registers of a function are its arguments followed by its non-void
+ * instructions, in the same order as the register layout of the generator.
+ * PHI nodes are handled as the generator does: the branch into a block
+ * writes the PHI registers of that block, using the incoming values, and the
+ * PHI instructions themselves neither read nor write.
+ */
+class RegisterLiveness {
+public:
+    RegisterLiveness(Function& F);
+
+    /**
+     * @brief The registers of the function, in register layout order.
+     */
+    std::vector<Value*> const& getRegisters() const {
+        return _registers;
+    }
+
+    /**
+     * @brief The registers that are live right before @c I executes,
+     * indexed as getRegisters().
+     */
+    BitVector const& liveAt(Instruction* I) const {
+        auto it = _liveAt.find(I);
+        assert(it != _liveAt.end());
+        return it->second;
+    }
+
+private:
+    int indexOf(Value* V) const;
+    void addUses(Instruction* I, BitVector& live) const;
+    BitVector liveOut(BasicBlock* BB, std::unordered_map<BasicBlock*, BitVector> const& liveIn) const;
+    BitVector scan(BasicBlock* BB, BitVector live, bool record);
+
+private:
+    std::vector<Value*> _registers;
+    std::unordered_map<Value*, int> _index;
+    std::unordered_map<Instruction*, BitVector> _liveAt;
+};
+
+} // namespace llmc
@@ -0,0 +1,98 @@
+/*
+ * LLMC - LLVM IR Model Checker
+ * Copyright © 2013-2021 Freark van der Berg
+ *
+ * This file is part of LLMC.
+ *
+ * LLMC is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * LLMC is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LLMC.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+#include <llvm/Analysis/AssumptionCache.h>
+#include <llvm/Analysis/LoopInfo.h>
+#include <llvm/Analysis/ScalarEvolution.h>
+#include <llvm/Analysis/TargetLibraryInfo.h>
+#include <llvm/IR/Dominators.h>
+#include <llvm/IR/Module.h>
+
+namespace llmc {
+
+using namespace llvm;
+
+/**
+ * @class ThreadCount
+ * @file ThreadCount.h
+ * @brief Infers an upper bound on the number of processes a program needs,
+ * from the structure of its pthread_create calls.
+ *
+ * Every pthread_create call site contributes the number of times it can be
+ * executed: the number of times its function can be executed, times the
+ * constant maximum trip count of every loop around it. Start routines count
+ * as executed once per pthread_create call that spawns them. Recursion,
+ * loops without a constant bound, functions whose address escapes and calls
+ * through a function pointer while the address of pthread_create is taken
+ * make the bound unknown.
+ */
+class ThreadCount {
+public:
+    static size_t const UNBOUNDED = ~(size_t)0;
+
+public:
+    ThreadCount(Module& module);
+    ~ThreadCount();
+
+    /**
+     * @brief Infers the number of processes, including the main thread.
+     * @return The number of processes, or UNBOUNDED if no bound could be
+     * inferred. In the latter case, getReason() describes why.
+     */
+    size_t infer();
+
+    std::string const& getReason() const {
+        return _reason;
+    }
+
+private:
+    struct FunctionAnalysis;
+
+    static bool isSpawn(CallBase* call);
+
+    /**
+     * @brief Whether every use of @c V, looking through casts, is as the
+     * callee of a call to @c F.
+     */
+    static bool isOnlyCalled(Value* V, Function* F);
+
+    size_t executions(Function* F);
+    size_t executions(Instruction* I);
+    bool addExecutionsOfUse(Function* F, User* user, size_t& count);
+    FunctionAnalysis& getAnalysis(Function* F);
+    size_t unbounded(std::string const& reason);
+
+private:
+    Module& _module;
+    TargetLibraryInfoImpl _tlii;
+    std::unordered_map<Function*, std::unique_ptr<FunctionAnalysis>> _analyses;
+    std::unordered_map<Function*, size_t> _executions;
+    std::unordered_set<Function*> _visiting;
+    std::unordered_set<Function*> _roots;
+    std::string _reason;
+};
+
+} // namespace llmc
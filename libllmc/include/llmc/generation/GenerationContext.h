@@ -78,6 +78,12 @@ public:
      */
     Value* thread_id;
 
+    /**
+     * Pointer to the registers of the current thread. These are downloaded
+     * from their chunk before the step and uploaded again after it.
+     */
+    Value* registers;
+
     /**
      * Whether the transition group changed the PC
      */
@@ -87,6 +93,26 @@ public:
 
     BasicBlock* noReportBB;
 
+    /**
+     * Pointer to the memory view of the step, if loads are cached
+     */
+    Value* memoryView;
+
+    /**
+     * Pointer to the store buffer of the step, if stores are coalesced
+     */
+    Value* storeBuffer;
+
+    /**
+     * Whether memory accesses currently go through the store buffer
+     */
+    bool bufferStores;
+
+    /**
+     * Whether a store was buffered since the last flush of the store buffer
+     */
+    bool storesBuffered;
+
     GenerationContext()
     :   gen(nullptr)
     ,   model(nullptr)
@@ -94,9 +120,14 @@ public:
     ,   svout(nullptr)
     ,   edgeLabels()
     ,   thread_id(0)
+    ,   registers(nullptr)
     ,   alteredPC(false)
     ,   userContext(nullptr)
     ,   noReportBB(nullptr)
+    ,   memoryView(nullptr)
+    ,   storeBuffer(nullptr)
+    ,   bufferStores(false)
+    ,   storesBuffered(false)
     {
     }
 };
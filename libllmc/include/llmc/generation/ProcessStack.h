@@ -83,9 +83,11 @@ public:
      * @param rframe_chunkID The chunkID of the registers to retore when this frame is popped
      * @param callSite The call instruction that causes this new frame
      * @param prevFrame_chunkID The chunkID of the previous stackframe on the stack
+     * @param memorySize The size of the memory of the process at the call,
+     * to restore when this frame is popped
      * @return Pointer to the memory location of the new frame
      */
-    Value* generateNewFrame(Value* oldPC, Value* rframe_chunkID, CallInst* callSite, Value* prevFrame_chunkID);
+    Value* generateNewFrame(Value* oldPC, Value* rframe_chunkID, CallInst* callSite, Value* prevFrame_chunkID, Value* memorySize);
 
     Value* getPrevPCFromFrame(Value* frame);
 
@@ -95,6 +97,39 @@ public:
 
     Value* getPrevStackChunkIDFromFrame(Value* frame);
 
+    Value* getMemorySizeFromFrame(Value* frame);
+
+    /**
+     * @brief Releases the memory allocated by the popped frame: the memory
+     * size of the process is restored to @c memorySize, unless it is already
+     * smaller, and the memory chunk is truncated to that size.
+     */
+    void releaseFrameMemory(GenerationContext* gctx, Value* memorySize);
+
+    /**
+     * @brief Releases the stack objects allocated by the popped frame, of a
+     * function that may allocate heap objects that outlive it. The objects
+     * beyond @c memorySize are walked: stack objects are zeroed and marked as
+     * freed, heap objects are kept, and the memory is truncated to the end
+     * of the last heap object.
+     */
+    void releaseFrameObjects(GenerationContext* gctx, Value* memorySize);
+
+    /**
+     * @brief Returns the registers the pushed frame is set up in: those of
+     * the current thread for a call, fresh registers for the setup call of
+     * main or a new thread.
+     */
+    Value* getRegistersForPush(GenerationContext* gctx, CallInst* callSite);
+
+    /**
+     * @brief Saves the registers of the caller that are live across
+     * @c callSite in a new register frame chunk.
+     * @return The chunk ID of the register frame, or 0 if no register is
+     * live across the call
+     */
+    Value* saveRegisters(GenerationContext* gctx, Value* registers, CallInst* callSite);
+
     /**
      * @brief Push a new frame on the stack, describing the current
      * call-state and how to revert to it. Then sets the program
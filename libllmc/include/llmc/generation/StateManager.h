@@ -24,6 +24,14 @@
 
 namespace llmc {
 
+/**
+ * @class StateManager
+ * @file StateManager.h
+ * @brief Generates the calls to the DMC API that store and retrieve chunks of
+ * a single type. Chunks of a type for which
+ * LLDMCModelGenerator::isBigChunkType() holds are handled by the dmc_big_*
+ * API; the word-based calls are then converted to bytes.
+ */
 class StateManager {
 private:
     Value* userContext;
@@ -52,7 +60,24 @@ public:
     Value* downloadPart(Value* stateID, Value* offset, Value* length, Value* data);
     Value* downloadPartBytes(Value* stateID, Value* offsetInBytes, Value* lengthInBytes, Value* data);
 
+    /**
+     * @brief Compares the value of the type of @c expected at
+     * @c offsetInBytes of the chunk at @c pStateID to @c expected and, if
+     * equal, replaces it by @c desired and stores the new chunk ID at
+     * @c pStateID. Only the compared bytes are downloaded.
+     * @return Whether the values were equal; @c loaded is set to the value
+     * that was in the chunk.
+     */
+    Value* compareAndDeltaBytes(Value* pStateID, Value* offsetInBytes, Value* expected, Value* desired, Value*& loaded);
+
+    /**
+     * @brief The length of the chunk with ID @c stateID. Not available for
+     * chunks of the dmc_big_* API.
+     */
     Value* getLength(Value* stateID);
+
+private:
+    Value* toBytes(Value* lengthInWords);
 };
 
 } // namespace llmc
\ No newline at end of file
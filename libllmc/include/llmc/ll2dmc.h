@@ -20,7 +20,10 @@
 #pragma once
 
 #include <libfrugi/Settings.h>
+#include <llvm/ExecutionEngine/Orc/ThreadSafeModule.h>
 #include <llmc/LLDMCModelGenerator.h>
+#include <llmc/transform/Optimize.h>
+#include <llmc/transform/Prune.h>
 
 using namespace libfrugi;
 
@@ -28,11 +31,44 @@ namespace llmc {
 
 class ll2dmc {
 public:
-    ll2dmc(MessageFormatter& out): _gen(nullptr), _llvmModel(nullptr), _out(out) {
+    ll2dmc(MessageFormatter& out)
+    : llvmctx(std::make_unique<llvm::LLVMContext>())
+    , _gen(nullptr)
+    , _llvmModel(nullptr)
+    , _out(out) {
+    }
+
+    /**
+     * @brief The ll2dmc.* settings that influence the generated model.
+     * Anything that caches translated models relies on this list.
+     */
+    static std::vector<std::string> const& settingNames() {
+        static std::vector<std::string> names = {
+            "assume_nonatomic_collapsable",
+            "threads",
+            "specialize_steps",
+            "report_deltas",
+            "por",
+            "collapse_thread_local",
+            "zero_dead_registers",
+            "inline_leaf_frames",
+            "heap_gc",
+            "heap_symmetry",
+            "thread_symmetry",
+            "paged_memory",
+            "big_chunk_threshold",
+            "coalesce_stores",
+            "memory_view",
+            "checks",
+            "optimize",
+            "optimize_aggressive",
+            "prune_unreachable",
+        };
+        return names;
     }
 
     bool init(File const& input, Settings const& settings) {
-        _llvmModel = llvm::getLazyIRFileModule(input.getFileRealPath(), Err, llvmctx);
+        _llvmModel = llvm::getLazyIRFileModule(input.getFileRealPath(), Err, *llvmctx.getContext());
         if(!_llvmModel) {
             string s;
             raw_string_ostream rsoout(s);
@@ -40,11 +76,92 @@ public:
             _out.reportError(rsoout.str());
             return false;
         }
+        bool prune = settings["prune_unreachable"].isOn();
+        bool optimize = settings["optimize"].isOn();
+        bool optimizeAggressive = settings["optimize_aggressive"].isOn();
+        if(optimizeAggressive && !optimize) {
+            _out.reportWarning("optimize_aggressive has no effect without optimize");
+        }
+        if(prune || optimize) {
+            auto err = _llvmModel->materializeAll();
+            if(err) {
+                _out.reportError("Could not load the model: " + toString(std::move(err)));
+                return false;
+            }
+        }
+        if(prune) {
+            ReachabilityPruner pruner(*_llvmModel);
+            pruner.run();
+            _out.reportNote("Pruned " + std::to_string(pruner.getPrunedFunctions()) + " functions and "
+                            + std::to_string(pruner.getPrunedGlobals())
+                            + " globals that are not reachable from main or the constructors");
+        }
+        if(optimize) {
+            auto before = ModelOptimizer::count(*_llvmModel);
+            ModelOptimizer(*_llvmModel, optimizeAggressive).run();
+            auto after = ModelOptimizer::count(*_llvmModel);
+            _out.reportNote("Optimization: " + std::to_string(before.programLocations) + " -> "
+                            + std::to_string(after.programLocations) + " program locations, "
+                            + std::to_string(before.registerSlots) + " -> "
+                            + std::to_string(after.registerSlots) + " register slots");
+        }
         _gen = new LLDMCModelGenerator(std::move(_llvmModel), _out);
-        _gen->enableDebugChecks();
+        std::string checks = settings["checks"].asString();
+        if(checks.empty() || checks == "full") {
+            _gen->setChecks(LLDMCModelGenerator::Checks::Full);
+        } else if(checks == "static") {
+            _gen->setChecks(LLDMCModelGenerator::Checks::Static);
+        } else if(checks == "none") {
+            _gen->setChecks(LLDMCModelGenerator::Checks::None);
+        } else {
+            _out.reportError("Unknown checks mode: " + checks + ", expected none, static or full");
+            return false;
+        }
         if(settings["assume_nonatomic_collapsable"].isOn()) {
             _gen->assumeNonAtomicCollapsable();
         }
+        if(settings["threads"].asUnsignedValue() > LLDMCModelGenerator::MAX_PROCESSES) {
+            _out.reportError("At most " + std::to_string(LLDMCModelGenerator::MAX_PROCESSES) + " processes are supported");
+            return false;
+        }
+        _gen->setMaxThreads(settings["threads"].asUnsignedValue());
+        if(settings["specialize_steps"].isOn()) {
+            _gen->specializeStepProcess();
+        }
+        if(settings["report_deltas"].isOn()) {
+            _gen->reportDeltas();
+        }
+        if(settings["por"].isOn()) {
+            _gen->partialOrderReduction();
+        }
+        if(settings["collapse_thread_local"].isOn()) {
+            _gen->collapseThreadLocal();
+        }
+        if(settings["zero_dead_registers"].isOn()) {
+            _gen->zeroDeadRegisters();
+        }
+        if(settings["inline_leaf_frames"].isOn()) {
+            _gen->inlineLeafFrames();
+        }
+        if(settings["heap_gc"].isOn()) {
+            _gen->heapGarbageCollection();
+        }
+        if(settings["heap_symmetry"].isOn()) {
+            _gen->heapSymmetry();
+        }
+        if(settings["thread_symmetry"].isOn()) {
+            _gen->threadSymmetry();
+        }
+        if(settings["paged_memory"].isOn()) {
+            _gen->pagedMemory();
+        }
+        _gen->bigChunkThreshold(settings["big_chunk_threshold"].asUnsignedValue());
+        if(settings["coalesce_stores"].isOn()) {
+            _gen->coalesceStores();
+        }
+        if(settings["memory_view"].isOn()) {
+            _gen->memoryView();
+        }
         return true;
     }
 
@@ -56,8 +173,17 @@ public:
         _gen->writeTo(output.getFilePath());
     }
 
+    /**
+     * @brief Takes the translated model, linked with the LLMC VM, for
+     * in-process compilation. The context is shared with the returned
+     * module, so it stays alive as long as the module does.
+     */
+    llvm::orc::ThreadSafeModule takeModule() {
+        return llvm::orc::ThreadSafeModule(_gen->releaseModule(), llvmctx);
+    }
+
 private:
-    llvm::LLVMContext llvmctx;
+    llvm::orc::ThreadSafeContext llvmctx;
     llvm::SMDiagnostic Err;
     LLDMCModelGenerator* _gen;
     std::unique_ptr<Module> _llvmModel;
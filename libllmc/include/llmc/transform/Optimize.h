@@ -0,0 +1,85 @@
+/*
+ * LLMC - LLVM IR Model Checker
+ * Copyright © 2013-2021 Freark van der Berg
+ *
+ * This file is part of LLMC.
+ *
+ * LLMC is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * LLMC is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LLMC.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstddef>
+
+#include <llvm/IR/Function.h>
+#include <llvm/IR/Module.h>
+
+namespace llmc {
+
+using namespace llvm;
+
+/**
+ * @class ModelOptimizer
+ * @file Optimize.h
+ * @brief Simplifies the input module before it is translated, such that the
+ * model has fewer program locations and registers.
+ *
+ * Only transformations that cannot change what other processes observe are
+ * used: promoting allocas that do not escape to registers (SROA, mem2reg),
+ * simplifying instructions that do not access memory (instsimplify, GVN
+ * without memory dependences), removing trivially dead instructions and
+ * cleaning up the CFG without hoisting, sinking or speculating code.
+ * Loads and stores of memory other processes may access are never removed,
+ * merged or moved, and atomics are left alone.
+ *
+ * The aggressive pipeline, with optimize_aggressive, runs instcombine,
+ * EarlyCSE, GVN with load elimination and the full simplifycfg after that.
+ * These may merge, remove and move non-atomic loads and stores, such as the
+ * load in a spin loop, so they are only sound for programs of which the
+ * non-atomic accesses are invisible to other processes. They are never
+ * used unless asked for, also not with assume_nonatomic_collapsable.
+ */
+class ModelOptimizer {
+public:
+
+    /**
+     * @brief The size of a module as the generator sees it: every
+     * instruction is a program location, every argument and non-void
+     * instruction a register. The registers of a function take as many
+     * 32-bit slots as the struct of their types.
+     */
+    struct Statistics {
+        size_t programLocations = 0;
+        size_t registers = 0;
+        size_t registerSlots = 0;
+    };
+
+    ModelOptimizer(Module& module, bool aggressive);
+
+    /**
+     * @brief Optimizes all defined functions of the module, which must be
+     * materialized.
+     */
+    void run();
+
+    static Statistics count(Module& module);
+
+private:
+    static bool cleanupCFG(Function& F);
+
+private:
+    Module& _module;
+    bool _aggressive;
+};
+
+} // namespace llmc
@@ -0,0 +1,79 @@
+/*
+ * LLMC - LLVM IR Model Checker
+ * Copyright © 2013-2021 Freark van der Berg
+ *
+ * This file is part of LLMC.
+ *
+ * LLMC is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * LLMC is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LLMC.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <unordered_set>
+#include <vector>
+
+#include <llvm/IR/Module.h>
+
+namespace llmc {
+
+using namespace llvm;
+
+/**
+ * @class ReachabilityPruner
+ * @file Prune.h
+ * @brief Removes the functions and globals that no execution of the program
+ * can reach, such that they get no transition groups, registers or memory.
+ *
+ * The roots are main(), llvm.global_ctors and the constructor function the
+ * generator starts by name. A global value is reachable if it is a root or
+ * if it is referenced by the body of a reachable function, the initializer of
+ * a reachable global variable or the aliasee of a reachable alias. This
+ * includes functions of which a reachable function takes the address, such
+ * as thread functions passed to pthread_create(), and functions in a
+ * reachable vtable. Unreachable definitions are removed; an unreachable
+ * function that is still referenced by another unreachable value becomes a
+ * declaration until that value is removed.
+ */
+class ReachabilityPruner {
+public:
+    ReachabilityPruner(Module& module);
+
+    /**
+     * @brief Removes the unreachable functions and global variables of the
+     * module, which must be materialized.
+     */
+    void run();
+
+    size_t getPrunedFunctions() const {
+        return _prunedFunctions;
+    }
+
+    size_t getPrunedGlobals() const {
+        return _prunedGlobals;
+    }
+
+private:
+    void reach(GlobalValue* GV);
+    void scan(llvm::Value* V);
+
+private:
+    Module& _module;
+    std::unordered_set<GlobalValue*> _reachable;
+    std::unordered_set<Constant*> _scanned;
+    std::vector<GlobalValue*> _todo;
+    size_t _prunedFunctions;
+    size_t _prunedGlobals;
+};
+
+} // namespace llmc
@@ -0,0 +1,112 @@
+/*
+ * LLMC - LLVM IR Model Checker
+ * Copyright © 2013-2021 Freark van der Berg
+ *
+ * This file is part of LLMC.
+ *
+ * LLMC is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * LLMC is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LLMC.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <llmc/transform/Optimize.h>
+
+#include <vector>
+
+#include <llvm/IR/LegacyPassManager.h>
+#include <llvm/Pass.h>
+#include <llvm/Transforms/InstCombine/InstCombine.h>
+#include <llvm/Transforms/Scalar.h>
+#include <llvm/Transforms/Scalar/GVN.h>
+#include <llvm/Transforms/Utils.h>
+#include <llvm/Transforms/Utils/BasicBlockUtils.h>
+#include <llvm/Transforms/Utils/Local.h>
+
+namespace llmc {
+
+ModelOptimizer::ModelOptimizer(Module& module, bool aggressive)
+: _module(module)
+, _aggressive(aggressive)
+{
+}
+
+void ModelOptimizer::run() {
+    legacy::FunctionPassManager fpm(&_module);
+    fpm.add(createSROAPass());
+    fpm.add(createPromoteMemoryToRegisterPass());
+    fpm.add(createInstSimplifyLegacyPass());
+
+    // Without memory dependence analysis, GVN does not eliminate loads
+    fpm.add(createGVNPass(true));
+    fpm.add(createDeadCodeEliminationPass());
+
+    // These may merge, remove and move loads and stores, for example fold
+    // the load of a spin loop out of the loop
+    if(_aggressive) {
+        fpm.add(createEarlyCSEPass());
+        fpm.add(createInstructionCombiningPass());
+        fpm.add(createGVNPass());
+        fpm.add(createCFGSimplificationPass());
+        fpm.add(createDeadCodeEliminationPass());
+    }
+
+    fpm.doInitialization();
+    for(auto& F: _module) {
+        if(F.isDeclaration()) continue;
+        fpm.run(F);
+        cleanupCFG(F);
+    }
+    fpm.doFinalization();
+}
+
+bool ModelOptimizer::cleanupCFG(Function& F) {
+    bool changed = false;
+    for(auto& BB: F) {
+        changed |= ConstantFoldTerminator(&BB, true);
+    }
+    changed |= removeUnreachableBlocks(F);
+
+    // Merging erases the merged block, so iterate over a copy
+    std::vector<BasicBlock*> blocks;
+    for(auto& BB: F) {
+        blocks.push_back(&BB);
+    }
+    for(auto BB: blocks) {
+        changed |= MergeBlockIntoPredecessor(BB);
+    }
+    return changed;
+}
+
+ModelOptimizer::Statistics ModelOptimizer::count(Module& module) {
+    Statistics stats;
+    auto& DL = module.getDataLayout();
+    for(auto& F: module) {
+        if(F.isDeclaration()) continue;
+        std::vector<Type*> types;
+        for(auto& arg: F.args()) {
+            types.push_back(arg.getType());
+        }
+        for(auto& BB: F) {
+            for(auto& I: BB) {
+                stats.programLocations++;
+                if(!I.getType()->isVoidTy()) {
+                    types.push_back(I.getType());
+                }
+            }
+        }
+        stats.registers += types.size();
+        auto size = DL.getTypeAllocSize(StructType::get(module.getContext(), types, false));
+        stats.registerSlots += (size + 3) / 4;
+    }
+    return stats;
+}
+
+} // namespace llmc
@@ -0,0 +1,124 @@
+/*
+ * LLMC - LLVM IR Model Checker
+ * Copyright © 2013-2021 Freark van der Berg
+ *
+ * This file is part of LLMC.
+ *
+ * LLMC is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * LLMC is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LLMC.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <llmc/transform/Prune.h>
+
+#include <llvm/IR/Constants.h>
+#include <llvm/IR/GlobalAlias.h>
+#include <llvm/IR/Instructions.h>
+
+namespace llmc {
+
+ReachabilityPruner::ReachabilityPruner(Module& module)
+: _module(module)
+, _prunedFunctions(0)
+, _prunedGlobals(0)
+{
+}
+
+void ReachabilityPruner::reach(GlobalValue* GV) {
+    if(_reachable.insert(GV).second) {
+        _todo.push_back(GV);
+    }
+}
+
+void ReachabilityPruner::scan(Value* V) {
+    if(auto GV = dyn_cast<GlobalValue>(V)) {
+        reach(GV);
+        return;
+    }
+
+    // Constants are shared, so each is only scanned once
+    auto C = dyn_cast<Constant>(V);
+    if(!C || !_scanned.insert(C).second) {
+        return;
+    }
+    for(auto& op: C->operands()) {
+        scan(op);
+    }
+}
+
+void ReachabilityPruner::run() {
+    for(auto name: {"main", "llvm.global_ctors", "_GLOBAL__sub_I_test.cpp"}) {
+        if(auto GV = _module.getNamedValue(name)) {
+            reach(GV);
+        }
+    }
+
+    while(!_todo.empty()) {
+        GlobalValue* GV = _todo.back();
+        _todo.pop_back();
+        if(auto F = dyn_cast<Function>(GV)) {
+            if(F->hasPersonalityFn()) {
+                scan(F->getPersonalityFn());
+            }
+            for(auto& BB: *F) {
+                for(auto& I: BB) {
+                    for(auto& op: I.operands()) {
+                        scan(op);
+                    }
+                }
+            }
+        } else if(auto V = dyn_cast<GlobalVariable>(GV)) {
+            if(V->hasInitializer()) {
+                scan(V->getInitializer());
+            }
+        } else if(auto A = dyn_cast<GlobalAlias>(GV)) {
+            scan(A->getAliasee());
+        }
+    }
+
+    // First drop all references of the unreachable values, such that they
+    // only remain in use by each other as declarations
+    std::vector<GlobalValue*> unreachable;
+    for(auto& F: _module) {
+        if(_reachable.count(&F)) continue;
+        if(!F.isDeclaration()) {
+            F.deleteBody();
+            _prunedFunctions++;
+        }
+        unreachable.push_back(&F);
+    }
+    for(auto& V: _module.globals()) {
+        if(_reachable.count(&V)) continue;
+        if(V.hasInitializer()) {
+            V.setInitializer(nullptr);
+            _prunedGlobals++;
+        }
+        unreachable.push_back(&V);
+    }
+    for(auto& A: _module.aliases()) {
+        if(_reachable.count(&A)) continue;
+        A.dropAllReferences();
+        unreachable.push_back(&A);
+    }
+
+    // Drop dead constants referencing the values, e.g. the GEPs of a
+    // removed function, and erase what is no longer used
+    for(auto GV: unreachable) {
+        GV->removeDeadConstantUsers();
+    }
+    for(auto GV: unreachable) {
+        if(GV->use_empty()) {
+            GV->eraseFromParent();
+        }
+    }
+}
+
+} // namespace llmc
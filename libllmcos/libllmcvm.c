@@ -160,4 +160,1163 @@ void __LLMCOS_CheckRangeIsInRange(const void * ptr, size_t ptr_size, const void
 
 int __LLMCOS_memcmp(const void* s1, const void* s2, size_t n) {
     return memcmp(s1, s2, n);
-}
\ No newline at end of file
+}
+
+/**
+ * Determines the range [*first, *last) of 32-bit words in which @c a and @c b
+ * differ. If they do not differ, the range is [0, 1), such that it can
+ * always be used as a delta.
+ */
+void llmc_diff_range(const __uint32_t* a, const __uint32_t* b, size_t words, size_t* first, size_t* last) {
+    size_t f = 0;
+    size_t l = words;
+    while(f < words && a[f] == b[f]) {
+        f++;
+    }
+    if(f == words) {
+        *first = 0;
+        *last = words ? 1 : 0;
+        return;
+    }
+    while(l > f && a[l-1] == b[l-1]) {
+        l--;
+    }
+    *first = f;
+    *last = l;
+}
+
+/**
+ * Kinds of objects in the memory of a process, as written in the header in
+ * front of every object by the generator.
+ */
+enum {
+    LLMC_OBJECT_STACK = 1,
+    LLMC_OBJECT_HEAP = 2,
+    LLMC_OBJECT_FREED = 3,
+};
+
+/**
+ * The header in front of every object. The lowest 8 bits of @c kind hold the
+ * kind of the object, the others the allocation site the generator assigned
+ * to it, or 0 if it assigned none.
+ */
+typedef struct {
+    __uint32_t size;
+    __uint32_t kind;
+} __attribute((packed)) llmc_object_header;
+
+__uint32_t llmc_object_kind(llmc_object_header h) {
+    return h.kind & 0xFF;
+}
+
+__uint32_t llmc_object_site(llmc_object_header h) {
+    return h.kind >> 8;
+}
+
+typedef struct {
+    __uint32_t pc;
+    __uint64_t rframe;
+    __uint32_t resultOffset;
+    __uint64_t prevStack;
+    __uint32_t msize;
+} __attribute((packed)) llmc_stack_frame;
+
+/**
+ * Offsets into the layout array of the state-vector the generator passes to
+ * the VM. The offsets of the fields of a process are those of process 0.
+ */
+enum {
+    LLMC_SV_PROCESSES,
+    LLMC_SV_PROCESS_STRIDE,
+    LLMC_SV_PC,
+    LLMC_SV_STACK,
+    LLMC_SV_REGISTERS,
+    LLMC_SV_MEMORY,
+    LLMC_SV_THREAD_RESULTS,
+    LLMC_SV_GLOBALS_SIZE,
+    LLMC_SV_PROCESS,
+    LLMC_SV_TID,
+    LLMC_SV_MEMORY_SIZE,
+    LLMC_SV_PAGED,
+};
+
+typedef void (*llmc_get_chunk)(void* ctx, __uint64_t id, void* data);
+typedef __uint64_t (*llmc_put_chunk)(void* ctx, void* data, __uint64_t length);
+
+/**
+ * Paged memory: the memory of a process is a tree with a fanout of
+ * LLMC_PAGE_FANOUT and up to LLMC_PAGE_LEVELS levels of directories above
+ * pages of LLMC_PAGE_SIZE bytes. A directory is a chunk of the IDs of its
+ * children, without trailing zero IDs. Chunk ID 0 is a page or directory of
+ * zeroes, so memory that was never written or was released takes no chunks.
+ *
+ * The tree is only as high as the memory written to needs, because a store
+ * uploads a chunk for every level: the root is a chunk of the number of
+ * directory levels followed by the root node, see llmc_paged_root. A write
+ * beyond the span of the tree adds directories on top, and directories of
+ * which only the first child is left are removed again.
+ */
+#define LLMC_PAGE_SIZE 256
+#define LLMC_PAGE_FANOUT 64
+#define LLMC_PAGE_LEVELS 3
+
+typedef struct {
+    __uint64_t level;
+    char node[LLMC_PAGE_FANOUT * sizeof(__uint64_t)];
+} llmc_paged_root;
+
+/**
+ * The number of writes to paged memory and of the chunks they inserted,
+ * reported when the model is unloaded.
+ */
+__uint64_t llmc_paged_writes = 0;
+__uint64_t llmc_paged_inserts = 0;
+
+__attribute__((destructor))
+void llmc_paged_report(void) {
+    if(llmc_paged_writes) {
+        fprintf(stderr, "[LLMC VM] Paged memory: %" PRIu64 " writes inserted %" PRIu64 " chunks\n", llmc_paged_writes, llmc_paged_inserts);
+    }
+}
+
+__uint64_t llmc_paged_put(void* ctx, llmc_put_chunk put, void* data, size_t length) {
+    __atomic_fetch_add(&llmc_paged_inserts, 1, __ATOMIC_RELAXED);
+    return put(ctx, data, length);
+}
+
+__uint64_t llmc_paged_span(int level) {
+    __uint64_t span = LLMC_PAGE_SIZE;
+    while(level--) {
+        span *= LLMC_PAGE_FANOUT;
+    }
+    return span;
+}
+
+void llmc_paged_get(void* ctx, llmc_get_chunk get, __uint64_t id, void* data, size_t size) {
+    memset(data, 0, size);
+    if(id) {
+        assert((id >> 40) <= size);
+        get(ctx, id, data);
+    }
+}
+
+size_t llmc_paged_node_size(int level) {
+    return level ? LLMC_PAGE_FANOUT * sizeof(__uint64_t) : LLMC_PAGE_SIZE;
+}
+
+/**
+ * The number of bytes of @c node at @c level to store: none if it is all
+ * zeroes, otherwise the whole page or the directory up to its last child.
+ */
+size_t llmc_paged_node_used(const char* node, int level) {
+    size_t used = llmc_paged_node_size(level);
+    while(used && !node[used - 1]) {
+        used--;
+    }
+    if(!used) return 0;
+    if(level == 0) return LLMC_PAGE_SIZE;
+    return (used + sizeof(__uint64_t) - 1) / sizeof(__uint64_t) * sizeof(__uint64_t);
+}
+
+void llmc_paged_read_node(void* ctx, llmc_get_chunk get, __uint64_t id, int level, __uint64_t offset, __uint64_t length, char* data);
+
+void llmc_paged_read_loaded(void* ctx, llmc_get_chunk get, const char* node, int level, __uint64_t offset, __uint64_t length, char* data) {
+    if(level == 0) {
+        memcpy(data, node + offset, length);
+        return;
+    }
+    __uint64_t span = llmc_paged_span(level - 1);
+    while(length) {
+        __uint64_t child = offset / span;
+        __uint64_t childOffset = offset % span;
+        __uint64_t childLength = span - childOffset < length ? span - childOffset : length;
+        __uint64_t childID;
+        memcpy(&childID, node + child * sizeof(childID), sizeof(childID));
+        llmc_paged_read_node(ctx, get, childID, level - 1, childOffset, childLength, data);
+        offset += childLength;
+        length -= childLength;
+        data += childLength;
+    }
+}
+
+void llmc_paged_read_node(void* ctx, llmc_get_chunk get, __uint64_t id, int level, __uint64_t offset, __uint64_t length, char* data) {
+    if(!id) {
+        memset(data, 0, length);
+        return;
+    }
+    char node[LLMC_PAGE_FANOUT * sizeof(__uint64_t)];
+    llmc_paged_get(ctx, get, id, node, llmc_paged_node_size(level));
+    llmc_paged_read_loaded(ctx, get, node, level, offset, length, data);
+}
+
+__uint64_t llmc_paged_write_node(void* ctx, llmc_get_chunk get, llmc_put_chunk put, __uint64_t id, int level, __uint64_t offset, __uint64_t length, const char* data);
+
+/**
+ * Writes @c length bytes of @c data, or zeroes if @c data is NULL, at
+ * @c offset of @c node at @c level, uploading the children written to.
+ */
+void llmc_paged_write_loaded(void* ctx, llmc_get_chunk get, llmc_put_chunk put, char* node, int level, __uint64_t offset, __uint64_t length, const char* data) {
+    if(level == 0) {
+        if(data) {
+            memcpy(node + offset, data, length);
+        } else {
+            memset(node + offset, 0, length);
+        }
+        return;
+    }
+    __uint64_t span = llmc_paged_span(level - 1);
+    while(length) {
+        __uint64_t child = offset / span;
+        __uint64_t childOffset = offset % span;
+        __uint64_t childLength = span - childOffset < length ? span - childOffset : length;
+        __uint64_t childID;
+        memcpy(&childID, node + child * sizeof(childID), sizeof(childID));
+        childID = llmc_paged_write_node(ctx, get, put, childID, level - 1, childOffset, childLength, data);
+        memcpy(node + child * sizeof(childID), &childID, sizeof(childID));
+        offset += childLength;
+        length -= childLength;
+        if(data) {
+            data += childLength;
+        }
+    }
+}
+
+/**
+ * Writes @c length bytes of @c data, or zeroes if @c data is NULL, at
+ * @c offset of the node @c id and returns the ID of the new node.
+ */
+__uint64_t llmc_paged_write_node(void* ctx, llmc_get_chunk get, llmc_put_chunk put, __uint64_t id, int level, __uint64_t offset, __uint64_t length, const char* data) {
+    if(!id && !data) {
+        return 0;
+    }
+    char node[LLMC_PAGE_FANOUT * sizeof(__uint64_t)];
+    llmc_paged_get(ctx, get, id, node, llmc_paged_node_size(level));
+    llmc_paged_write_loaded(ctx, get, put, node, level, offset, length, data);
+    size_t used = llmc_paged_node_used(node, level);
+    return used ? llmc_paged_put(ctx, put, node, used) : 0;
+}
+
+void llmc_paged_root_get(void* ctx, llmc_get_chunk get, __uint64_t root, llmc_paged_root* r) {
+    llmc_paged_get(ctx, get, root, r, sizeof(*r));
+}
+
+/**
+ * Uploads the root @c r after removing the directories of which only the
+ * first child is left, so that the same memory always has the same root.
+ */
+__uint64_t llmc_paged_root_put(void* ctx, llmc_get_chunk get, llmc_put_chunk put, llmc_paged_root* r) {
+    while(r->level && llmc_paged_node_used(r->node, (int)r->level) <= sizeof(__uint64_t)) {
+        __uint64_t child;
+        memcpy(&child, r->node, sizeof(child));
+        r->level--;
+        llmc_paged_get(ctx, get, child, r->node, llmc_paged_node_size((int)r->level));
+    }
+    size_t used = llmc_paged_node_used(r->node, (int)r->level);
+    return used ? llmc_paged_put(ctx, put, r, sizeof(r->level) + used) : 0;
+}
+
+void llmc_paged_check(__uint64_t offset, __uint64_t length) {
+    if(offset + length > llmc_paged_span(LLMC_PAGE_LEVELS)) {
+        fprintf(stderr, "[LLMC VM] Access beyond paged memory: %" PRIu64 " + %" PRIu64 "\n", offset, length);
+        abort();
+    }
+}
+
+/**
+ * Reads @c length bytes at @c offset of the paged memory @c root into
+ * @c data.
+ */
+void llmc_paged_read(void* ctx, llmc_get_chunk get, __uint64_t root, __uint64_t offset, __uint64_t length, char* data) {
+    llmc_paged_check(offset, length);
+    llmc_paged_root r;
+    llmc_paged_root_get(ctx, get, root, &r);
+    __uint64_t span = llmc_paged_span((int)r.level);
+    if(offset + length > span) {
+        __uint64_t inside = offset < span ? span - offset : 0;
+        memset(data + inside, 0, length - inside);
+        length = inside;
+    }
+    if(length) {
+        llmc_paged_read_loaded(ctx, get, r.node, (int)r.level, offset, length, data);
+    }
+}
+
+/**
+ * Writes @c length bytes of @c data at @c offset of the paged memory
+ * @c root. Only the pages written to and the directories above them are
+ * uploaded again.
+ * @return The new root.
+ */
+__uint64_t llmc_paged_write(void* ctx, llmc_get_chunk get, llmc_put_chunk put, __uint64_t root, __uint64_t offset, __uint64_t length, const char* data) {
+    llmc_paged_check(offset, length);
+    __atomic_fetch_add(&llmc_paged_writes, 1, __ATOMIC_RELAXED);
+    llmc_paged_root r;
+    llmc_paged_root_get(ctx, get, root, &r);
+    while(offset + length > llmc_paged_span((int)r.level)) {
+        size_t used = llmc_paged_node_used(r.node, (int)r.level);
+        __uint64_t child = used ? llmc_paged_put(ctx, put, r.node, used) : 0;
+        memset(r.node, 0, sizeof(r.node));
+        memcpy(r.node, &child, sizeof(child));
+        r.level++;
+    }
+    llmc_paged_write_loaded(ctx, get, put, r.node, (int)r.level, offset, length, data);
+    return llmc_paged_root_put(ctx, get, put, &r);
+}
+
+/**
+ * Zeroes the paged memory @c root from @c size onwards.
+ * @return The new root.
+ */
+__uint64_t llmc_paged_truncate(void* ctx, llmc_get_chunk get, llmc_put_chunk put, __uint64_t root, __uint64_t size) {
+    llmc_paged_root r;
+    llmc_paged_root_get(ctx, get, root, &r);
+    __uint64_t span = llmc_paged_span((int)r.level);
+    if(size >= span) {
+        return root;
+    }
+    llmc_paged_write_loaded(ctx, get, put, r.node, (int)r.level, size, span - size, NULL);
+    return llmc_paged_root_put(ctx, get, put, &r);
+}
+
+typedef struct llmc_heap llmc_heap;
+typedef void (*llmc_heap_visit)(llmc_heap* heap, char* at, size_t idx);
+
+/**
+ * The objects in the memory of one process, found by walking the object
+ * headers from the end of the globals.
+ */
+struct llmc_heap {
+    void* ctx;
+    llmc_get_chunk get;
+    char* memory;
+    __uint32_t heapStart;
+    __uint64_t tag;
+    __uint32_t* objects;
+    __uint32_t* newOffsets;
+    size_t count;
+    char* marked;
+    size_t* found;
+    size_t foundCount;
+    int moved;
+    int ambiguous;
+    char* base;
+    const char* known;
+};
+
+llmc_object_header llmc_heap_header(llmc_heap* heap, size_t idx) {
+    llmc_object_header h;
+    memcpy(&h, heap->memory + heap->objects[idx], sizeof(h));
+    return h;
+}
+
+/**
+ * Finds the objects in @c memory. Returns 0 if the memory does not consist
+ * of whole objects, which is the case if allocations are not tracked.
+ */
+int llmc_heap_init(llmc_heap* heap, void* ctx, llmc_get_chunk get, const __uint32_t* layout, __uint32_t process, char* memory, __uint32_t size) {
+    llmc_object_header h;
+    __uint32_t heapStart = process == 0 ? layout[LLMC_SV_GLOBALS_SIZE] : 0;
+    size_t count = 0;
+    __uint32_t offset = heapStart;
+    while(offset + sizeof(h) <= size) {
+        memcpy(&h, memory + offset, sizeof(h));
+        if(llmc_object_kind(h) < LLMC_OBJECT_STACK || llmc_object_kind(h) > LLMC_OBJECT_FREED || offset + sizeof(h) + h.size > size) {
+            return 0;
+        }
+        offset += sizeof(h) + h.size;
+        count++;
+    }
+    if(offset != size || !count) {
+        return 0;
+    }
+    heap->ctx = ctx;
+    heap->get = get;
+    heap->memory = memory;
+    heap->heapStart = heapStart;
+    heap->tag = process + 1;
+    heap->objects = malloc(count * sizeof(__uint32_t));
+    heap->newOffsets = malloc(count * sizeof(__uint32_t));
+    heap->count = count;
+    heap->marked = calloc(count, 1);
+    heap->found = malloc(count * sizeof(size_t));
+    heap->foundCount = 0;
+    heap->moved = 0;
+    heap->ambiguous = 0;
+    heap->base = NULL;
+    heap->known = NULL;
+    offset = heapStart;
+    for(size_t i = 0; i < count; ++i) {
+        heap->objects[i] = offset;
+        heap->newOffsets[i] = offset;
+        offset += sizeof(h) + llmc_heap_header(heap, i).size;
+    }
+    return 1;
+}
+
+void llmc_heap_destroy(llmc_heap* heap) {
+    free(heap->objects);
+    free(heap->newOffsets);
+    free(heap->marked);
+    free(heap->found);
+}
+
+/**
+ * Finds the object @c offset points into. A pointer one past the end of an
+ * object equals the offset of the header of the next object, or the end of
+ * the memory, and belongs to the object it is one past the end of. Offsets
+ * within a header and in the globals are not in any object.
+ * @return The index of the object, or -1.
+ */
+long llmc_heap_find(llmc_heap* heap, __uint64_t offset) {
+    size_t lo = 0;
+    size_t hi = heap->count;
+    while(lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        __uint64_t start = heap->objects[mid] + sizeof(llmc_object_header);
+        if(offset < start) {
+            hi = mid;
+        } else if(offset > start + llmc_heap_header(heap, mid).size) {
+            lo = mid + 1;
+        } else {
+            return mid;
+        }
+    }
+    return -1;
+}
+
+/**
+ * Visits every pointer in @c data to an object of the process. This is
+ * conservative: every 8-byte aligned slot of @c data holding a value that
+ * looks like a pointer created by the process counts as one. The generator
+ * places pointers at aligned offsets of the globals, registers and objects.
+ * @c known marks the slots known to hold a pointer, see
+ * llmc_heap_is_known(), or is NULL if none are.
+ */
+void llmc_heap_scan_known(llmc_heap* heap, char* data, size_t len, const char* known, llmc_heap_visit visit) {
+    heap->base = data;
+    heap->known = known;
+    for(size_t i = 0; i + sizeof(__uint64_t) <= len; i += sizeof(__uint64_t)) {
+        __uint64_t v;
+        memcpy(&v, data + i, sizeof(v));
+        if((v >> 56) != heap->tag) continue;
+        long idx = llmc_heap_find(heap, v & 0xFFFFFFFFFFFFFFULL);
+        if(idx >= 0) {
+            visit(heap, data + i, idx);
+        }
+    }
+}
+
+void llmc_heap_scan(llmc_heap* heap, char* data, size_t len, llmc_heap_visit visit) {
+    llmc_heap_scan_known(heap, data, len, NULL, visit);
+}
+
+/**
+ * Whether the slot at @c at of the data being scanned is known to hold a
+ * pointer, as opposed to holding something that may only look like one.
+ */
+int llmc_heap_is_known(llmc_heap* heap, char* at) {
+    return heap->known && heap->known[(at - heap->base) / sizeof(__uint64_t)];
+}
+
+/**
+ * Creates a map of the 8-byte slots of @c len bytes, marking the slots at
+ * the @c count byte offsets @c offsets. Unaligned offsets are ignored, so
+ * those slots are not known to hold a pointer.
+ */
+char* llmc_heap_known_slots(const __uint32_t* offsets, __uint32_t count, size_t len) {
+    size_t slots = len / sizeof(__uint64_t);
+    char* known = calloc(slots + 1, 1);
+    for(__uint32_t i = 0; i < count; ++i) {
+        if(offsets[i] % sizeof(__uint64_t) == 0 && offsets[i] / sizeof(__uint64_t) < slots) {
+            known[offsets[i] / sizeof(__uint64_t)] = 1;
+        }
+    }
+    return known;
+}
+
+/**
+ * The offsets of the pointers in the objects of every allocation site: the
+ * @c count[s] offsets from @c offsets + @c start[s] for site @c s, repeated
+ * every @c stride[s] bytes, since an allocation may hold an array. Sites
+ * without a known type have no offsets.
+ */
+typedef struct {
+    const __uint32_t* offsets;
+    const __uint32_t* start;
+    const __uint32_t* count;
+    const __uint32_t* stride;
+    __uint32_t sites;
+} llmc_heap_sites;
+
+/**
+ * Creates a map of the 8-byte slots of object @c idx, marking the slots
+ * known to hold a pointer by the allocation site of the object.
+ */
+char* llmc_heap_object_known(llmc_heap* heap, const llmc_heap_sites* sites, size_t idx) {
+    llmc_object_header h = llmc_heap_header(heap, idx);
+    size_t slots = h.size / sizeof(__uint64_t);
+    char* known = calloc(slots + 1, 1);
+    __uint32_t site = llmc_object_site(h);
+    if(site == 0 || site >= sites->sites || sites->stride[site] == 0) {
+        return known;
+    }
+    const __uint32_t* offsets = sites->offsets + sites->start[site];
+    for(size_t base = 0; base < h.size; base += sites->stride[site]) {
+        for(__uint32_t k = 0; k < sites->count[site]; ++k) {
+            size_t offset = base + offsets[k];
+            if(offset % sizeof(__uint64_t) == 0 && offset / sizeof(__uint64_t) < slots) {
+                known[offset / sizeof(__uint64_t)] = 1;
+            }
+        }
+    }
+    return known;
+}
+
+void llmc_heap_scan_chunk(llmc_heap* heap, __uint64_t id, llmc_heap_visit visit) {
+    size_t len = id >> 40;
+    if(!len) return;
+    char* data = malloc(len);
+    heap->get(heap->ctx, id, data);
+    llmc_heap_scan(heap, data, len, visit);
+    free(data);
+}
+
+/**
+ * Visits the pointers to the objects of process @c process that are held
+ * outside its memory: in the registers and register frames of all
+ * processes, in the memory of the other processes and in the thread
+ * results. The registers of @c process itself are only scanned if
+ * @c ownRegisters is set.
+ */
+void llmc_heap_scan_external(llmc_heap* heap, const char* sv, const __uint32_t* layout, __uint32_t process, int ownRegisters, llmc_heap_visit visit) {
+    __uint64_t id;
+    for(__uint32_t p = 0; p < layout[LLMC_SV_PROCESSES]; ++p) {
+        const char* proc = sv + p * layout[LLMC_SV_PROCESS_STRIDE];
+        if(p != process || ownRegisters) {
+            memcpy(&id, proc + layout[LLMC_SV_REGISTERS], sizeof(id));
+            llmc_heap_scan_chunk(heap, id, visit);
+        }
+        memcpy(&id, proc + layout[LLMC_SV_STACK], sizeof(id));
+        while(id >> 40 >= sizeof(llmc_stack_frame)) {
+            llmc_stack_frame frame;
+            char* data = malloc(id >> 40);
+            heap->get(heap->ctx, id, data);
+            memcpy(&frame, data, sizeof(frame));
+            free(data);
+            llmc_heap_scan_chunk(heap, frame.rframe, visit);
+            id = frame.prevStack;
+        }
+        if(p != process) {
+            memcpy(&id, proc + layout[LLMC_SV_MEMORY], sizeof(id));
+            if(layout[LLMC_SV_PAGED]) {
+                __uint32_t size;
+                memcpy(&size, proc + layout[LLMC_SV_MEMORY_SIZE], sizeof(size));
+                char* data = malloc(size);
+                llmc_paged_read(heap->ctx, heap->get, id, 0, size, data);
+                llmc_heap_scan(heap, data, size, visit);
+                free(data);
+            } else {
+                llmc_heap_scan_chunk(heap, id, visit);
+            }
+        }
+    }
+    memcpy(&id, sv + layout[LLMC_SV_THREAD_RESULTS], sizeof(id));
+    llmc_heap_scan_chunk(heap, id, visit);
+}
+
+/**
+ * Visits the pointers held by the globals and the stack objects of the
+ * process, in address order.
+ */
+void llmc_heap_scan_roots(llmc_heap* heap, llmc_heap_visit visit) {
+    llmc_heap_scan(heap, heap->memory, heap->heapStart, visit);
+    for(size_t i = 0; i < heap->count; ++i) {
+        llmc_object_header h = llmc_heap_header(heap, i);
+        if(llmc_object_kind(h) == LLMC_OBJECT_STACK) {
+            llmc_heap_scan(heap, heap->memory + heap->objects[i] + sizeof(h), h.size, visit);
+        }
+    }
+}
+
+void llmc_heap_mark(llmc_heap* heap, char* at, size_t idx) {
+    (void)at;
+    if(!heap->marked[idx]) {
+        heap->marked[idx] = 1;
+        heap->found[heap->foundCount++] = idx;
+    }
+}
+
+/**
+ * Marks the heap objects reachable from the marked objects, breadth-first,
+ * such that heap->found holds the objects in the order they were found.
+ */
+void llmc_heap_trace(llmc_heap* heap) {
+    for(size_t k = 0; k < heap->foundCount; ++k) {
+        size_t idx = heap->found[k];
+        llmc_object_header h = llmc_heap_header(heap, idx);
+        if(llmc_object_kind(h) == LLMC_OBJECT_HEAP) {
+            llmc_heap_scan(heap, heap->memory + heap->objects[idx] + sizeof(h), h.size, llmc_heap_mark);
+        }
+    }
+}
+
+/**
+ * Collects the unreachable heap objects in @c memory, the @c size bytes of
+ * memory of process @c process in the state-vector @c sv. Objects are
+ * reachable from the globals, from stack objects and from everything
+ * llmc_heap_scan_external() scans. Unreachable heap objects are zeroed and
+ * marked as freed, and freed objects at the end of the memory are dropped.
+ * Chunks are downloaded using @c get.
+ * @return The new size of the memory, or -1 if nothing changed.
+ */
+__int64_t llmc_gc(void* ctx, llmc_get_chunk get, const char* sv, const __uint32_t* layout, __uint32_t process, char* memory, __uint32_t size) {
+    llmc_heap heap;
+    if(!llmc_heap_init(&heap, ctx, get, layout, process, memory, size)) {
+        return -1;
+    }
+    llmc_heap_scan_roots(&heap, llmc_heap_mark);
+    llmc_heap_scan_external(&heap, sv, layout, process, 1, llmc_heap_mark);
+    llmc_heap_trace(&heap);
+
+    // Sweep
+    int changed = 0;
+    for(size_t i = 0; i < heap.count; ++i) {
+        llmc_object_header h = llmc_heap_header(&heap, i);
+        if(llmc_object_kind(h) == LLMC_OBJECT_HEAP && !heap.marked[i]) {
+            memset(memory + heap.objects[i] + sizeof(h), 0, h.size);
+            h.kind = LLMC_OBJECT_FREED;
+            memcpy(memory + heap.objects[i], &h, sizeof(h));
+            changed = 1;
+        }
+    }
+    __int64_t newSize = size;
+    for(size_t i = heap.count; i > 0; --i) {
+        if(llmc_object_kind(llmc_heap_header(&heap, i-1)) != LLMC_OBJECT_FREED) break;
+        newSize = heap.objects[i-1];
+        changed = 1;
+    }
+
+    llmc_heap_destroy(&heap);
+    return changed ? newSize : -1;
+}
+
+/**
+ * Releases the objects of a returning call in @c memory, the @c size bytes
+ * of memory that were allocated since the call. Stack objects are zeroed and
+ * marked as freed; heap objects outlive the call and are kept in place.
+ * @return The size up to the end of the last heap object, to which the
+ * memory can be truncated.
+ */
+__uint32_t llmc_release_frame(char* memory, __uint32_t size) {
+    __uint32_t end = 0;
+    __uint32_t offset = 0;
+    while(offset + sizeof(llmc_object_header) <= size) {
+        llmc_object_header h;
+        memcpy(&h, memory + offset, sizeof(h));
+        if(offset + sizeof(h) + h.size > size) {
+            break;
+        }
+        if(llmc_object_kind(h) == LLMC_OBJECT_STACK) {
+            memset(memory + offset + sizeof(h), 0, h.size);
+            h.kind = LLMC_OBJECT_FREED;
+            memcpy(memory + offset, &h, sizeof(h));
+        } else if(llmc_object_kind(h) == LLMC_OBJECT_HEAP) {
+            end = offset + sizeof(h) + h.size;
+        }
+        offset += sizeof(h) + h.size;
+    }
+    return end;
+}
+
+/**
+ * The number of states of which the heap was relabeled by
+ * llmc_heap_canonicalize(), reported when the model is unloaded.
+ */
+__uint64_t llmc_heap_relabeled = 0;
+
+__attribute__((destructor))
+void llmc_heap_report(void) {
+    if(llmc_heap_relabeled) {
+        fprintf(stderr, "[LLMC VM] Heap symmetry: relabeled the heap of %" PRIu64 " states\n", llmc_heap_relabeled);
+    }
+}
+
+void llmc_heap_check_moved(llmc_heap* heap, char* at, size_t idx) {
+    (void)at;
+    if(heap->newOffsets[idx] != heap->objects[idx]) {
+        heap->moved = 1;
+    }
+}
+
+void llmc_heap_check_ambiguous(llmc_heap* heap, char* at, size_t idx) {
+    if(heap->newOffsets[idx] != heap->objects[idx] && !llmc_heap_is_known(heap, at)) {
+        heap->ambiguous = 1;
+    }
+}
+
+void llmc_heap_relocate(llmc_heap* heap, char* at, size_t idx) {
+    if(!llmc_heap_is_known(heap, at)) return;
+    __uint64_t v;
+    memcpy(&v, at, sizeof(v));
+    v += (__uint64_t)heap->newOffsets[idx] - heap->objects[idx];
+    memcpy(at, &v, sizeof(v));
+}
+
+/**
+ * Relabels the heap objects of process @c process, such that the layout of
+ * its memory does not depend on the order in which the objects were
+ * allocated. Within every run of adjacent heap objects, the objects are
+ * ordered by when a breadth-first traversal finds them, rooted at the
+ * globals, the @c registersSize bytes of @c registers of the process and
+ * its stack objects. Objects that are not found stay behind the found
+ * ones, in their original order. Stack objects never move, so frames can
+ * still release their memory.
+ *
+ * Only the pointers in slots known to hold one are rewritten: the
+ * @c globalPointerCount offsets @c globalPointers into the globals and the
+ * @c registerPointerCount offsets @c registerPointers into the registers,
+ * of the pointer-typed globals and registers, and in the objects the
+ * offsets of their allocation site, see llmc_heap_sites. Nothing is changed
+ * if a moved object may be pointed to from any other slot, since that may
+ * be an integer that only looks like a pointer, nor if a moved object is
+ * pointed to from outside, see llmc_heap_scan_external().
+ * @return Whether @c memory and @c registers changed.
+ */
+__int32_t llmc_heap_canonicalize(void* ctx, llmc_get_chunk get, const char* sv, const __uint32_t* layout, __uint32_t process, char* memory, __uint32_t size, char* registers, __uint32_t registersSize, const __uint32_t* globalPointers, __uint32_t globalPointerCount, const __uint32_t* registerPointers, __uint32_t registerPointerCount, const __uint32_t* sitePointers, const __uint32_t* sitePointerStart, const __uint32_t* sitePointerCount, const __uint32_t* siteStride, __uint32_t sites) {
+    llmc_heap_sites siteTables = {sitePointers, sitePointerStart, sitePointerCount, siteStride, sites};
+    llmc_heap heap;
+    if(!llmc_heap_init(&heap, ctx, get, layout, process, memory, size)) {
+        return 0;
+    }
+    llmc_heap_scan(&heap, memory, heap.heapStart, llmc_heap_mark);
+    llmc_heap_scan(&heap, registers, registersSize, llmc_heap_mark);
+    for(size_t i = 0; i < heap.count; ++i) {
+        llmc_object_header h = llmc_heap_header(&heap, i);
+        if(llmc_object_kind(h) == LLMC_OBJECT_STACK) {
+            llmc_heap_scan(&heap, memory + heap.objects[i] + sizeof(h), h.size, llmc_heap_mark);
+        }
+    }
+    llmc_heap_trace(&heap);
+
+    // The rank of an object is when it was found, after all found objects
+    // if it was not
+    size_t* rank = malloc(heap.count * sizeof(size_t));
+    for(size_t i = 0; i < heap.count; ++i) {
+        rank[i] = heap.count + i;
+    }
+    for(size_t k = 0; k < heap.foundCount; ++k) {
+        rank[heap.found[k]] = k;
+    }
+
+    // Order every run of heap objects by rank
+    size_t* order = malloc(heap.count * sizeof(size_t));
+    size_t i = 0;
+    while(i < heap.count) {
+        if(llmc_object_kind(llmc_heap_header(&heap, i)) == LLMC_OBJECT_STACK) {
+            i++;
+            continue;
+        }
+        size_t first = i;
+        while(i < heap.count && llmc_object_kind(llmc_heap_header(&heap, i)) != LLMC_OBJECT_STACK) {
+            size_t j = i - first;
+            while(j > 0 && rank[order[first + j - 1]] > rank[i]) {
+                order[first + j] = order[first + j - 1];
+                j--;
+            }
+            order[first + j] = i;
+            i++;
+        }
+        __uint32_t offset = heap.objects[first];
+        for(size_t k = first; k < i; ++k) {
+            heap.newOffsets[order[k]] = offset;
+            offset += sizeof(llmc_object_header) + llmc_heap_header(&heap, order[k]).size;
+        }
+    }
+    free(rank);
+
+    free(order);
+
+    // Moving objects that are pointed to from outside is not supported
+    int changed = 0;
+    for(i = 0; i < heap.count; ++i) {
+        if(heap.newOffsets[i] != heap.objects[i]) {
+            changed = 1;
+        }
+    }
+    if(changed) {
+        llmc_heap_scan_external(&heap, sv, layout, process, 0, llmc_heap_check_moved);
+        changed = !heap.moved;
+    }
+
+    char* knownGlobals = llmc_heap_known_slots(globalPointers, globalPointerCount, heap.heapStart);
+    char* knownRegisters = llmc_heap_known_slots(registerPointers, registerPointerCount, registersSize);
+    char** knownObjects = calloc(heap.count, sizeof(char*));
+    for(i = 0; changed && i < heap.count; ++i) {
+        knownObjects[i] = llmc_heap_object_known(&heap, &siteTables, i);
+    }
+    if(changed) {
+        llmc_heap_scan_known(&heap, memory, heap.heapStart, knownGlobals, llmc_heap_check_ambiguous);
+        llmc_heap_scan_known(&heap, registers, registersSize, knownRegisters, llmc_heap_check_ambiguous);
+        for(i = 0; i < heap.count; ++i) {
+            llmc_object_header h = llmc_heap_header(&heap, i);
+            llmc_heap_scan_known(&heap, memory + heap.objects[i] + sizeof(h), h.size, knownObjects[i], llmc_heap_check_ambiguous);
+        }
+        changed = !heap.ambiguous;
+    }
+
+    // Rewrite the pointers, then move the objects
+    if(changed) {
+        llmc_heap_scan_known(&heap, memory, heap.heapStart, knownGlobals, llmc_heap_relocate);
+        llmc_heap_scan_known(&heap, registers, registersSize, knownRegisters, llmc_heap_relocate);
+        for(i = 0; i < heap.count; ++i) {
+            llmc_object_header h = llmc_heap_header(&heap, i);
+            llmc_heap_scan_known(&heap, memory + heap.objects[i] + sizeof(h), h.size, knownObjects[i], llmc_heap_relocate);
+        }
+        char* copy = malloc(size);
+        memcpy(copy, memory, size);
+        for(i = 0; i < heap.count; ++i) {
+            llmc_object_header h;
+            memcpy(&h, copy + heap.objects[i], sizeof(h));
+            memcpy(memory + heap.newOffsets[i], copy + heap.objects[i], sizeof(h) + h.size);
+        }
+        free(copy);
+        __atomic_fetch_add(&llmc_heap_relabeled, 1, __ATOMIC_RELAXED);
+    }
+    for(i = 0; i < heap.count; ++i) {
+        free(knownObjects[i]);
+    }
+    free(knownObjects);
+    free(knownGlobals);
+    free(knownRegisters);
+    llmc_heap_destroy(&heap);
+    return changed;
+}
+
+/**
+ * The number of states of which the threads were reordered by
+ * llmc_thread_canonicalize(), reported when the model is unloaded.
+ */
+__uint64_t llmc_threads_reordered = 0;
+
+__attribute__((destructor))
+void llmc_threads_report(void) {
+    if(llmc_threads_reordered) {
+        fprintf(stderr, "[LLMC VM] Thread symmetry: reordered the threads of %" PRIu64 " states\n", llmc_threads_reordered);
+    }
+}
+
+/**
+ * The start routine of the running thread in process slot @c p: the
+ * function of the location the oldest frame on its stack returns to, or
+ * of its program location if its stack is empty. @c locationFunctions
+ * maps a program location to the index of its function plus one.
+ */
+__uint32_t llmc_thread_start_routine(void* ctx, llmc_get_chunk get, const char* sv, const __uint32_t* layout, const __uint32_t* locationFunctions, __uint32_t p) {
+    const char* proc = sv + p * layout[LLMC_SV_PROCESS_STRIDE];
+    __uint32_t pc;
+    __uint64_t id;
+    memcpy(&pc, proc + layout[LLMC_SV_PC], sizeof(pc));
+    memcpy(&id, proc + layout[LLMC_SV_STACK], sizeof(id));
+    while(id >> 40 >= sizeof(llmc_stack_frame)) {
+        llmc_stack_frame frame;
+        char* data = malloc(id >> 40);
+        get(ctx, id, data);
+        memcpy(&frame, data, sizeof(frame));
+        free(data);
+        pc = frame.pc;
+        id = frame.prevStack;
+    }
+    return locationFunctions[pc];
+}
+
+/**
+ * Compares the local state of the running threads in process slots @c a
+ * and @c b: the program location, the stack, the registers and the
+ * thread ID to break ties.
+ */
+int llmc_thread_compare(const char* sv, const __uint32_t* layout, __uint32_t a, __uint32_t b) {
+    static const int chunks[] = {LLMC_SV_STACK, LLMC_SV_REGISTERS};
+    __uint32_t stride = layout[LLMC_SV_PROCESS_STRIDE];
+    __uint32_t va, vb;
+    memcpy(&va, sv + a * stride + layout[LLMC_SV_PC], sizeof(va));
+    memcpy(&vb, sv + b * stride + layout[LLMC_SV_PC], sizeof(vb));
+    if(va != vb) return va < vb ? -1 : 1;
+    for(size_t c = 0; c < sizeof(chunks) / sizeof(chunks[0]); ++c) {
+        __uint64_t ca, cb;
+        memcpy(&ca, sv + a * stride + layout[chunks[c]], sizeof(ca));
+        memcpy(&cb, sv + b * stride + layout[chunks[c]], sizeof(cb));
+        if(ca != cb) return ca < cb ? -1 : 1;
+    }
+    memcpy(&va, sv + a * stride + layout[LLMC_SV_TID], sizeof(va));
+    memcpy(&vb, sv + b * stride + layout[LLMC_SV_TID], sizeof(vb));
+    return va < vb ? -1 : va > vb;
+}
+
+/**
+ * Places the running threads of state-vector @c sv that have no memory
+ * in the order of their start routine and then their local state, see
+ * llmc_thread_start_routine() and llmc_thread_compare(), so that states
+ * that only differ in which process slots these threads run in are the
+ * same. The main process, the slots a new thread can be started in and
+ * threads that allocated memory stay where they are.
+ *
+ * Only the process entries are moved: a thread keeps its thread ID, so
+ * the thread results and the pthread_t values in the program, of which
+ * copies cannot all be found, stay valid. Pointers name the process slot
+ * whose memory they point into, which is why a thread that allocated
+ * memory, and so may be pointed into, is not moved.
+ * @return Whether @c sv changed.
+ */
+__int32_t llmc_thread_canonicalize(void* ctx, llmc_get_chunk get, char* sv, const __uint32_t* layout, const __uint32_t* locationFunctions) {
+    __uint32_t processes = layout[LLMC_SV_PROCESSES];
+    __uint32_t stride = layout[LLMC_SV_PROCESS_STRIDE];
+    __uint32_t* slots = malloc(processes * sizeof(__uint32_t));
+    __uint32_t* routines = malloc(processes * sizeof(__uint32_t));
+    __uint32_t movable = 0;
+    for(__uint32_t p = 1; p < processes; ++p) {
+        __uint32_t pc, memorySize;
+        memcpy(&pc, sv + p * stride + layout[LLMC_SV_PC], sizeof(pc));
+        memcpy(&memorySize, sv + p * stride + layout[LLMC_SV_MEMORY_SIZE], sizeof(memorySize));
+        if(pc && !memorySize) {
+            slots[movable] = p;
+            routines[movable] = llmc_thread_start_routine(ctx, get, sv, layout, locationFunctions, p);
+            movable++;
+        }
+    }
+
+    // Sort the movable threads; order[i] moves to slots[i]
+    __uint32_t* order = malloc(processes * sizeof(__uint32_t));
+    int moved = 0;
+    for(__uint32_t i = 0; i < movable; ++i) {
+        __uint32_t j = i;
+        while(j > 0 && (routines[order[j - 1]] > routines[i]
+                    || (routines[order[j - 1]] == routines[i] && llmc_thread_compare(sv, layout, slots[order[j - 1]], slots[i]) > 0))) {
+            order[j] = order[j - 1];
+            j--;
+        }
+        order[j] = i;
+    }
+    for(__uint32_t i = 0; i < movable; ++i) {
+        if(order[i] != i) {
+            moved = 1;
+        }
+    }
+
+    if(moved) {
+        char* entries = sv + layout[LLMC_SV_PROCESS];
+        char* copy = malloc(processes * stride);
+        memcpy(copy, entries, processes * stride);
+        for(__uint32_t i = 0; i < movable; ++i) {
+            memcpy(entries + slots[i] * stride, copy + slots[order[i]] * stride, stride);
+        }
+        free(copy);
+        __atomic_fetch_add(&llmc_threads_reordered, 1, __ATOMIC_RELAXED);
+    }
+
+    free(slots);
+    free(routines);
+    free(order);
+    return moved;
+}
+
+typedef void (*llmc_read_memory)(void* ctx, void* chunk, __uint64_t offset, __uint64_t length, void* data);
+typedef void (*llmc_write_memory)(void* ctx, void* chunk, __uint64_t offset, __uint64_t length, const void* data);
+
+/**
+ * Store buffer: the stores of a transition group to the memory of a process
+ * are collected in a single range of up to LLMC_STORE_BUFFER_SIZE bytes and
+ * written to the memory chunk as one delta when the buffer is flushed. The
+ * bytes between two buffered stores are read from the chunk, so the range
+ * can always be written as a whole. @c chunk is the location of the chunk
+ * ID of the memory in the state-vector, or NULL if the buffer is empty.
+ */
+#define LLMC_STORE_BUFFER_SIZE 256
+
+typedef struct {
+    void* chunk;
+    __uint64_t start;
+    __uint64_t end;
+    char data[LLMC_STORE_BUFFER_SIZE];
+} llmc_store_buffer;
+
+/**
+ * The number of stores that were merged into a buffered range by
+ * llmc_store_buffer_write(), reported when the model is unloaded.
+ */
+__uint64_t llmc_store_buffer_coalesced = 0;
+
+__attribute__((destructor))
+void llmc_store_buffer_report(void) {
+    if(llmc_store_buffer_coalesced) {
+        fprintf(stderr, "[LLMC VM] Store coalescing: merged %" PRIu64 " stores into an earlier delta\n", llmc_store_buffer_coalesced);
+    }
+}
+
+/**
+ * Writes the buffered range to the memory chunk and empties the buffer.
+ */
+void llmc_store_buffer_flush(void* ctx, llmc_write_memory write, llmc_store_buffer* sb) {
+    if(!sb->chunk) {
+        return;
+    }
+    write(ctx, sb->chunk, sb->start, sb->end - sb->start, sb->data);
+    sb->chunk = NULL;
+}
+
+/**
+ * Buffers the store of @c length bytes of @c data at @c offset of the memory
+ * with the chunk ID at @c chunk. If the store does not fit in the buffered
+ * range, the buffer is flushed first.
+ */
+void llmc_store_buffer_write(void* ctx, llmc_read_memory read, llmc_write_memory write, llmc_store_buffer* sb, void* chunk, __uint64_t offset, __uint64_t length, const char* data) {
+    if(sb->chunk == chunk) {
+        __uint64_t start = offset < sb->start ? offset : sb->start;
+        __uint64_t end = offset + length > sb->end ? offset + length : sb->end;
+        if(end - start <= LLMC_STORE_BUFFER_SIZE) {
+
+            // Grow the range, filling the gaps from the chunk
+            if(start < sb->start) {
+                memmove(sb->data + (sb->start - start), sb->data, sb->end - sb->start);
+                read(ctx, chunk, start, sb->start - start, sb->data);
+            }
+            if(end > sb->end) {
+                read(ctx, chunk, sb->end, end - sb->end, sb->data + (sb->end - start));
+            }
+            sb->start = start;
+            sb->end = end;
+            memcpy(sb->data + (offset - start), data, length);
+            __atomic_fetch_add(&llmc_store_buffer_coalesced, 1, __ATOMIC_RELAXED);
+            return;
+        }
+    }
+    llmc_store_buffer_flush(ctx, write, sb);
+    if(length > LLMC_STORE_BUFFER_SIZE) {
+        write(ctx, chunk, offset, length, data);
+        return;
+    }
+    sb->chunk = chunk;
+    sb->start = offset;
+    sb->end = offset + length;
+    memcpy(sb->data, data, length);
+}
+
+/**
+ * Overlays the buffered bytes on @c data, the @c length bytes at @c offset
+ * that were read from the memory with the chunk ID at @c chunk.
+ */
+void llmc_store_buffer_read(llmc_store_buffer* sb, void* chunk, __uint64_t offset, __uint64_t length, char* data) {
+    if(sb->chunk != chunk) {
+        return;
+    }
+    __uint64_t start = offset > sb->start ? offset : sb->start;
+    __uint64_t end = offset + length < sb->end ? offset + length : sb->end;
+    if(start < end) {
+        memcpy(data + (start - offset), sb->data + (start - sb->start), end - start);
+    }
+}
+
+/**
+ * Memory view: a window of up to LLMC_MEMORY_VIEW_SIZE bytes of the memory
+ * of a process that was read during the current step, such that loads close
+ * to an earlier load do not go to the storage again. The window belongs to
+ * the chunk with ID @c id, of which the ID is at @c chunk in the
+ * state-vector; once that location holds another ID, the window is no
+ * longer used, unless llmc_memory_view_write() carried it over.
+ */
+#define LLMC_MEMORY_VIEW_SIZE 256
+#define LLMC_MEMORY_VIEW_ALIGN 64
+
+typedef struct {
+    void* chunk;
+    __uint64_t id;
+    __uint64_t start;
+    __uint64_t end;
+    char data[LLMC_MEMORY_VIEW_SIZE];
+} llmc_memory_view;
+
+/**
+ * The number of reads served from a memory view, reported when the model is
+ * unloaded.
+ */
+__uint64_t llmc_memory_view_hits = 0;
+
+__attribute__((destructor))
+void llmc_memory_view_report(void) {
+    if(llmc_memory_view_hits) {
+        fprintf(stderr, "[LLMC VM] Memory view: served %" PRIu64 " reads without the storage\n", llmc_memory_view_hits);
+    }
+}
+
+/**
+ * Reads @c length bytes at @c offset of the memory with the chunk ID at
+ * @c chunk into @c data, from the view if it holds them. Otherwise a new
+ * window around @c offset is read, as far as it is inside the memory: the
+ * length of the chunk, or the span of paged memory if @c paged.
+ */
+void llmc_memory_view_read(void* ctx, llmc_read_memory read, llmc_memory_view* view, void* chunk, int paged, __uint64_t offset, __uint64_t length, char* data) {
+    __uint64_t id;
+    memcpy(&id, chunk, sizeof(id));
+    if(view->chunk == chunk && view->id == id && offset >= view->start && offset + length <= view->end) {
+        memcpy(data, view->data + (offset - view->start), length);
+        __atomic_fetch_add(&llmc_memory_view_hits, 1, __ATOMIC_RELAXED);
+        return;
+    }
+    __uint64_t limit = paged ? llmc_paged_span(LLMC_PAGE_LEVELS) : id >> 40;
+    __uint64_t start = offset & ~(__uint64_t)(LLMC_MEMORY_VIEW_ALIGN - 1);
+    __uint64_t end = start + LLMC_MEMORY_VIEW_SIZE < limit ? start + LLMC_MEMORY_VIEW_SIZE : limit;
+    if(offset + length > end) {
+        read(ctx, chunk, offset, length, data);
+        return;
+    }
+    read(ctx, chunk, start, end - start, view->data);
+    view->chunk = chunk;
+    view->id = id;
+    view->start = start;
+    view->end = end;
+    memcpy(data, view->data + (offset - start), length);
+}
+
+/**
+ * Keeps the view coherent with the write of @c length bytes of @c data at
+ * @c offset of the memory with the chunk ID at @c chunk, which held
+ * @c oldID before the write: the window is updated and moved to the new ID.
+ */
+void llmc_memory_view_write(llmc_memory_view* view, void* chunk, __uint64_t oldID, __uint64_t offset, __uint64_t length, const char* data) {
+    if(view->chunk != chunk || view->id != oldID) {
+        return;
+    }
+    __uint64_t start = offset > view->start ? offset : view->start;
+    __uint64_t end = offset + length < view->end ? offset + length : view->end;
+    if(start < end) {
+        memcpy(view->data + (start - view->start), data + (start - offset), end - start);
+    }
+    memcpy(&view->id, chunk, sizeof(view->id));
+}
+
+/**
+ * The number of register frames and stack frames that calls inserted into
+ * the storage, reported when the model is unloaded.
+ */
+__uint64_t llmc_rframe_inserts = 0;
+__uint64_t llmc_stack_inserts = 0;
+
+__attribute__((destructor))
+void llmc_frame_inserts_report(void) {
+    if(llmc_rframe_inserts || llmc_stack_inserts) {
+        fprintf(stderr, "[LLMC VM] Calls: inserted %" PRIu64 " register frames and %" PRIu64 " stack frames\n", llmc_rframe_inserts, llmc_stack_inserts);
+    }
+}
+
+/**
+ * Counts the insertion of a register frame by a call.
+ */
+void llmc_count_rframe_insert(void) {
+    __atomic_fetch_add(&llmc_rframe_inserts, 1, __ATOMIC_RELAXED);
+}
+
+/**
+ * Counts the insertion of a stack frame by a call.
+ */
+void llmc_count_stack_insert(void) {
+    __atomic_fetch_add(&llmc_stack_inserts, 1, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,312 @@
+/*
+ * LLMC - LLVM IR Model Checker
+ * Copyright © 2013-2021 Freark van der Berg
+ *
+ * This file is part of LLMC.
+ *
+ * LLMC is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * LLMC is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LLMC.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include "ModelCache.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iterator>
+#include <sstream>
+#include <vector>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+
+#include <dmc/common/murmurhash.h>
+#include <libfrugi/System.h>
+#include <llmc/ll2dmc.h>
+
+namespace fs = std::filesystem;
+
+namespace llmc {
+
+ModelCache::ModelCache(MessageFormatter& out, Settings const& settings)
+    : _out(out)
+    , _maxBytes(0)
+    , _ok(false)
+    {
+
+    // Determine the location of the cache
+    std::string dir = settings["dir"].asString();
+    if(dir.empty()) {
+        if(char const* xdg = getenv("XDG_CACHE_HOME"); xdg && *xdg) {
+            dir = std::string(xdg) + "/llmc";
+        } else if(char const* home = getenv("HOME"); home && *home) {
+            dir = std::string(home) + "/.cache/llmc";
+        } else {
+            _out.reportWarning("Model cache disabled: no cache directory (set --cache.dir)");
+            return;
+        }
+    }
+    _dir = dir;
+
+    // Size cap in MiB
+    uintmax_t maxMiB = settings["size"].asUnsignedValue();
+    _maxBytes = (maxMiB ? maxMiB : 1024) << 20;
+
+    std::error_code ec;
+    fs::create_directories(_dir, ec);
+    if(ec) {
+        _out.reportWarning("Model cache disabled: cannot create " + _dir.string() + ": " + ec.message());
+        return;
+    }
+    _ok = true;
+    loadStatistics();
+}
+
+/**
+ * The LLMC VM and OS files that end up in a model: the IR modules the
+ * generator links in and the archive the shared object is linked with.
+ * Each is looked up in the same order as LLDMCModelGenerator::loadModule()
+ * and link() do.
+ */
+static std::vector<File> runtimeFiles() {
+    std::string bin = System::getBinaryLocation();
+    std::string share = std::string(CompileOptions::CMAKE_INSTALL_PREFIX) + "/share/llmc";
+    std::vector<std::pair<std::string, std::vector<std::string>>> lookups = {
+        {"libllmcos.ll", {bin, share, bin + "/../libllmcos", bin + "/../libllmc"}},
+        {"libllmcvm.ll", {bin, share, bin + "/../libllmcos", bin + "/../libllmc"}},
+        {"libdmccapi.ll", {bin, share, bin + "/../libllmcos", bin + "/../libllmc"}},
+        {"libllmcvm.a", {bin, bin + "/../libllmcos", share}},
+    };
+    std::vector<File> files;
+    for(auto const& lookup: lookups) {
+        for(auto const& dir: lookup.second) {
+            File f(dir, lookup.first);
+            if(f.exists()) {
+                files.push_back(f);
+                break;
+            }
+        }
+    }
+    return files;
+}
+
+std::string ModelCache::keyFor(File const& input, Settings const& ll2dmcSettings) const {
+    std::ifstream in(input.getFileRealPath(), std::ios::binary);
+    if(!in) {
+        return "";
+    }
+    std::stringstream content;
+    content << in.rdbuf();
+
+    // Everything that influences the generated model goes into the key
+    content << '\0' << CompileOptions::LLMC_VERSION;
+    content << '\0' << CompileOptions::LLVM_PACKAGE_VERSION;
+    for(auto const& name: ll2dmc::settingNames()) {
+        content << '\0' << name << '=' << ll2dmcSettings[name].asString();
+    }
+
+    // The VM is rebuilt without a version change during development, so
+    // its contents go into the key as well
+    for(auto const& f: runtimeFiles()) {
+        std::ifstream runtime(f.getFileRealPath(), std::ios::binary);
+        content << '\0' << std::string(std::istreambuf_iterator<char>(runtime), std::istreambuf_iterator<char>());
+    }
+
+    std::string const& data = content.str();
+    std::stringstream key;
+    key << std::hex << std::setfill('0')
+        << std::setw(16) << MurmurHash64(data.data(), data.size(), 0x8445d61a4e774912ULL)
+        << std::setw(16) << MurmurHash64(data.data(), data.size(), 0xc6a4a7935bd1e995ULL)
+        ;
+    return key.str();
+}
+
+fs::path ModelCache::entryPath(std::string const& key) const {
+    return _dir / (key + ".so");
+}
+
+bool ModelCache::lookup(std::string const& key, File& so) {
+    if(!_ok || key.empty()) {
+        return false;
+    }
+    auto p = entryPath(key);
+    std::error_code ec;
+    if(fs::is_regular_file(p, ec)) {
+
+        // Mark the entry as recently used for eviction purposes
+        fs::last_write_time(p, fs::file_time_type::clock::now(), ec);
+        so = File(p.string());
+        Statistics delta;
+        delta.hits = 1;
+        updateStatistics(delta);
+        _out.reportSuccess("Model cache hit [" + p.string() + "]");
+        return true;
+    }
+    Statistics delta;
+    delta.misses = 1;
+    updateStatistics(delta);
+    _out.reportAction("Model cache miss [" + key + "]");
+    return false;
+}
+
+bool ModelCache::store(std::string const& key, File const& so) {
+    if(!_ok || key.empty()) {
+        return false;
+    }
+    auto p = entryPath(key);
+
+    // Copy and rename, so concurrent runs never load a partial entry
+    auto tmp = p;
+    tmp += "." + std::to_string(getpid()) + ".tmp";
+    std::error_code ec;
+    fs::copy_file(so.getFileRealPath(), tmp, fs::copy_options::overwrite_existing, ec);
+    if(!ec) {
+        fs::rename(tmp, p, ec);
+    }
+    if(ec) {
+        fs::remove(tmp, ec);
+        _out.reportWarning("Could not store model in cache: " + ec.message());
+        return false;
+    }
+    Statistics delta;
+    delta.stores = 1;
+    delta.evictions = evict();
+    updateStatistics(delta);
+    _out.reportAction("Stored model in cache [" + p.string() + "]");
+    return true;
+}
+
+size_t ModelCache::evict() {
+    struct Entry {
+        fs::path path;
+        fs::file_time_type time;
+        uintmax_t size;
+    };
+    std::vector<Entry> entries;
+    uintmax_t total = 0;
+
+    std::error_code ec;
+    for(auto const& e: fs::directory_iterator(_dir, ec)) {
+        if(!e.is_regular_file(ec) || e.path().extension() != ".so") continue;
+        Entry entry{e.path(), e.last_write_time(ec), e.file_size(ec)};
+        if(ec) continue;
+        total += entry.size;
+        entries.push_back(entry);
+    }
+
+    // Least recently used first
+    std::sort(entries.begin(), entries.end(), [](Entry const& a, Entry const& b) {
+        return a.time < b.time;
+    });
+
+    // Always keep the most recent entry, even if it exceeds the cap on its own
+    size_t evictions = 0;
+    for(size_t i = 0; total > _maxBytes && i + 1 < entries.size(); ++i) {
+        if(fs::remove(entries[i].path, ec)) {
+            total -= entries[i].size;
+            evictions++;
+            _out.reportNote("Evicted " + entries[i].path.filename().string() + " from model cache");
+        }
+    }
+    return evictions;
+}
+
+void ModelCache::loadStatistics() {
+    _stats = Statistics();
+    std::ifstream in(_dir / "stats");
+    std::string name;
+    size_t value;
+    while(in >> name >> value) {
+        if(name == "hits") _stats.hits = value;
+        else if(name == "misses") _stats.misses = value;
+        else if(name == "stores") _stats.stores = value;
+        else if(name == "evictions") _stats.evictions = value;
+    }
+}
+
+void ModelCache::updateStatistics(Statistics const& delta) {
+
+    // The stats file itself is replaced, so the lock is on a separate file
+    int lock = open((_dir / "stats.lock").c_str(), O_RDWR | O_CREAT, 0644);
+    if(lock >= 0) {
+        flock(lock, LOCK_EX);
+    }
+    loadStatistics();
+    _stats.hits += delta.hits;
+    _stats.misses += delta.misses;
+    _stats.stores += delta.stores;
+    _stats.evictions += delta.evictions;
+
+    auto p = _dir / "stats";
+    auto tmp = p;
+    tmp += "." + std::to_string(getpid()) + ".tmp";
+    {
+        std::ofstream out(tmp, std::fstream::trunc);
+        out << "hits " << _stats.hits << "\n"
+            << "misses " << _stats.misses << "\n"
+            << "stores " << _stats.stores << "\n"
+            << "evictions " << _stats.evictions << "\n"
+            ;
+    }
+    std::error_code ec;
+    fs::rename(tmp, p, ec);
+    if(ec) {
+        fs::remove(tmp, ec);
+    }
+    if(lock >= 0) {
+        flock(lock, LOCK_UN);
+        close(lock);
+    }
+}
+
+void ModelCache::reportStatistics() {
+    if(!_ok) {
+        return;
+    }
+    loadStatistics();
+    uintmax_t total = 0;
+    size_t entries = 0;
+    std::error_code ec;
+    for(auto const& e: fs::directory_iterator(_dir, ec)) {
+        if(!e.is_regular_file(ec) || e.path().extension() != ".so") continue;
+        total += e.file_size(ec);
+        entries++;
+    }
+    size_t lookups = _stats.hits + _stats.misses;
+    std::stringstream ss;
+    ss << "Model cache [" << _dir.string() << "]";
+    _out.reportAction(ss.str());
+    _out.indent();
+    ss.str("");
+    ss << "entries:   " << entries << " (" << (total >> 20) << " of " << (_maxBytes >> 20) << " MiB)";
+    _out.reportNote(ss.str());
+    ss.str("");
+    ss << "hits:      " << _stats.hits;
+    if(lookups) {
+        ss << " (" << (100 * _stats.hits / lookups) << "%)";
+    }
+    _out.reportNote(ss.str());
+    ss.str("");
+    ss << "misses:    " << _stats.misses;
+    _out.reportNote(ss.str());
+    ss.str("");
+    ss << "stores:    " << _stats.stores;
+    _out.reportNote(ss.str());
+    ss.str("");
+    ss << "evictions: " << _stats.evictions;
+    _out.reportNote(ss.str());
+    _out.outdent();
+}
+
+} // namespace llmc
@@ -0,0 +1,110 @@
+/*
+ * LLMC - LLVM IR Model Checker
+ * Copyright © 2013-2021 Freark van der Berg
+ *
+ * This file is part of LLMC.
+ *
+ * LLMC is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * LLMC is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LLMC.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+
+#include <libfrugi/FileSystem.h>
+#include <libfrugi/MessageFormatter.h>
+#include <libfrugi/Settings.h>
+
+namespace llmc {
+
+using namespace libfrugi;
+
+/**
+ * @class ModelCache
+ * @file ModelCache.h
+ * @brief Persistent on-disk cache of compiled model shared objects.
+ *
+ * Entries are addressed by a hash of the input LLVM IR, the ll2dmc settings
+ * that influence the generated model, the LLMC and LLVM versions and the
+ * contents of the LLMC VM and OS libraries that are linked in. The
+ * cache is kept below a size cap by evicting the least recently used
+ * entries. Hits, misses and evictions are counted across runs; concurrent
+ * runs update the counts under a lock on the stats file.
+ */
+class ModelCache {
+public:
+
+    struct Statistics {
+        size_t hits = 0;
+        size_t misses = 0;
+        size_t stores = 0;
+        size_t evictions = 0;
+    };
+
+public:
+
+    /**
+     * @brief Creates a cache in the directory specified by @c settings,
+     * or in the user's cache directory if none is specified.
+     * @param settings The cache.* sub-section of the settings.
+     */
+    ModelCache(MessageFormatter& out, Settings const& settings);
+
+    /**
+     * @brief Computes the key of the model translated from @c input using
+     * the ll2dmc.* settings @c ll2dmcSettings.
+     * @return The key, or an empty string if the input could not be read.
+     */
+    std::string keyFor(File const& input, Settings const& ll2dmcSettings) const;
+
+    /**
+     * @brief Looks up the shared object for @c key.
+     * @return true on a hit, in which case @c so is set to the cached
+     * shared object.
+     */
+    bool lookup(std::string const& key, File& so);
+
+    /**
+     * @brief Stores a copy of the shared object @c so under @c key and
+     * evicts entries until the cache is below its size cap.
+     */
+    bool store(std::string const& key, File const& so);
+
+    /**
+     * @brief Reports the statistics accumulated over all runs.
+     */
+    void reportStatistics();
+
+private:
+    std::filesystem::path entryPath(std::string const& key) const;
+    size_t evict();
+    void loadStatistics();
+
+    /**
+     * @brief Adds @c delta to the statistics in the cache directory, which
+     * are read again under a lock so that updates of concurrent runs are
+     * not lost, and replaces the file by renaming a new copy.
+     */
+    void updateStatistics(Statistics const& delta);
+
+private:
+    MessageFormatter& _out;
+    std::filesystem::path _dir;
+    uintmax_t _maxBytes;
+    bool _ok;
+    Statistics _stats;
+};
+
+} // namespace llmc
@@ -25,6 +25,7 @@
 #include <libfrugi/Shell.h>
 #include <libfrugi/System.h>
 #include <llmc/ll2dmc.h>
+#include <llmc/ModelJIT.h>
 //#include <llmc/ssgen.h>
 #include <dmc/modelcheckers/interface.h>
 #include <dmc/modelcheckers/multicoresimple.h>
@@ -38,11 +39,15 @@
 #include <dmc/storage/cchm.h>
 #include <dmc/storage/treedbs.h>
 #include <dmc/storage/treedbsmod.h>
+#include <chrono>
 #include <sstream>
 #include <dmc/common/murmurhash.h>
 
 #include <dmc/models/DMCModel.h>
 #include <libllmc/LLVMModel.h>
+#include <libllmc/JITModel.h>
+
+#include "ModelCache.h"
 
 #define VERBOSITY_SEARCHING 2
 
@@ -72,6 +77,29 @@ bool findBinary(std::string const& name, MessageFormatter& messageFormatter, Fil
     return !accessible;
 }
 
+/**
+ * @brief Measures the wall-clock time of an in-process phase and reports it
+ * in the same format as the external tools are reported.
+ */
+class PhaseTimer {
+public:
+    PhaseTimer(MessageFormatter& out): _out(out), _start(std::chrono::steady_clock::now()) {
+    }
+
+    double report() {
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - _start;
+        std::stringstream ss;
+        ss << "Took " << elapsed.count() << " second";
+        _out.reportAction(ss.str());
+        _start = std::chrono::steady_clock::now();
+        return elapsed.count();
+    }
+
+private:
+    MessageFormatter& _out;
+    std::chrono::steady_clock::time_point _start;
+};
+
 bool compile(File const& bin_llc, File const& input, File const& output, MessageFormatter& out) {
     Shell::RunStatistics stats;
     Shell::SystemOptions sysOps;
@@ -166,7 +194,7 @@ struct HashCompareMurmur {
 
 
 template<typename Storage, template<typename,typename> typename Printer = llmc::statespace::VoidPrinter, template <typename, typename, template<typename,typename> typename> typename ModelChecker>
-void goDMC(MessageFormatter& out, std::string soFile) {
+void goDMC(MessageFormatter& out, VModel<llmc::storage::StorageInterface>* model) {
     Settings& settings = Settings::global();
 
     ofstream f;
@@ -180,7 +208,6 @@ void goDMC(MessageFormatter& out, std::string soFile) {
 //                                > printer(f);
 //    ModelChecker<PINSModel, Storage, llmc::statespace::DotPrinter> mc(model, printer);
 
-    VModel<llmc::storage::StorageInterface>* model = DMCModel::get(soFile);
     if(model) {
         Printer<MC, VModel<llmc::storage::StorageInterface>> printer(f);
         printer.init();
@@ -211,11 +238,28 @@ void goDMC(MessageFormatter& out, std::string soFile) {
             size_t endStatesError = 0;
             Storage& storage = mc.getStorage();
             std::vector<typename Storage::StateSlot> buffer;
+
+            // Optionally write the root of every end state, one per line
+            std::ofstream endStatesFile;
+            std::string endStatesPath = settings["endstates"].asString();
+            if(!endStatesPath.empty()) {
+                endStatesFile.open(endStatesPath, std::fstream::trunc);
+                if(!endStatesFile.is_open()) {
+                    out.reportError("Cannot write end states to " + endStatesPath);
+                }
+            }
             for(auto const& s: endStates) {
                 size_t stateLength = storage.determineLength(s);
-                buffer.reserve(stateLength);
+                buffer.resize(stateLength);
                 mc.getState(s, buffer.data(), true);
                 printer.writeEndState(model, s, Storage::FullState::createExternal(true, stateLength, buffer.data()));
+                if(endStatesFile.is_open()) {
+                    endStatesFile << std::hex;
+                    for(size_t i = 0; i < stateLength; ++i) {
+                        endStatesFile << (i ? " " : "") << buffer[i];
+                    }
+                    endStatesFile << std::dec << "\n";
+                }
                 std::stringstream sss;
                 sss << s;
 
@@ -248,33 +292,33 @@ void goDMC(MessageFormatter& out, std::string soFile) {
 }
 
 template<typename Storage, template <typename, typename, template<typename,typename> typename> typename ModelChecker>
-void goSelectPrinter(MessageFormatter& out, std::string fileName) {
+void goSelectPrinter(MessageFormatter& out, VModel<llmc::storage::StorageInterface>* model) {
     Settings& settings = Settings::global();
     if(settings["listener"].asString() == "dotall") {
-        goDMC<Storage, llmc::statespace::DotPrinter, ModelChecker>(out, fileName);
+        goDMC<Storage, llmc::statespace::DotPrinter, ModelChecker>(out, model);
     } else if(settings["listener"].asString() == "dotend") {
-        goDMC<Storage, llmc::statespace::DotPrinterEndOnly, ModelChecker>(out, fileName);
+        goDMC<Storage, llmc::statespace::DotPrinterEndOnly, ModelChecker>(out, model);
     } else {
-        goDMC<Storage, llmc::statespace::VoidPrinter, ModelChecker>(out, fileName);
+        goDMC<Storage, llmc::statespace::VoidPrinter, ModelChecker>(out, model);
     }
 }
 
 template<template <typename, typename, template<typename,typename> typename> typename ModelChecker>
-void goSelectStorage(MessageFormatter& out, std::string fileName) {
+void goSelectStorage(MessageFormatter& out, VModel<llmc::storage::StorageInterface>* model) {
     Settings& settings = Settings::global();
 
     if(settings["storage"].asString() == "stdmap") {
-        goSelectPrinter<llmc::storage::StdMap, ModelChecker>(out, fileName);
+        goSelectPrinter<llmc::storage::StdMap, ModelChecker>(out, model);
     } else if(settings["storage"].asString() == "cchm") {
-        goSelectPrinter<llmc::storage::cchm, ModelChecker>(out, fileName);
+        goSelectPrinter<llmc::storage::cchm, ModelChecker>(out, model);
     } else if(settings["storage"].asString() == "treedbs_stdmap") {
-        goSelectPrinter<llmc::storage::TreeDBSStorage<llmc::storage::StdMap>, ModelChecker>(out, fileName);
+        goSelectPrinter<llmc::storage::TreeDBSStorage<llmc::storage::StdMap>, ModelChecker>(out, model);
     } else if(settings["storage"].asString() == "treedbs_cchm") {
-        goSelectPrinter<llmc::storage::TreeDBSStorage<llmc::storage::cchm>, ModelChecker>(out, fileName);
+        goSelectPrinter<llmc::storage::TreeDBSStorage<llmc::storage::cchm>, ModelChecker>(out, model);
     } else if(settings["storage"].asString() == "treedbsmod") {
-        goSelectPrinter<llmc::storage::TreeDBSStorageModified, ModelChecker>(out, fileName);
+        goSelectPrinter<llmc::storage::TreeDBSStorageModified, ModelChecker>(out, model);
     } else if(settings["storage"].asString() == "dtree") {
-        goSelectPrinter<llmc::storage::DTreeStorage<SeparateRootSingleHashSet<HashSet128<RehasherExit, QuadLinear, HashCompareMurmur>, HashSet<RehasherExit, QuadLinear, HashCompareMurmur>>>, ModelChecker>(out, fileName);
+        goSelectPrinter<llmc::storage::DTreeStorage<SeparateRootSingleHashSet<HashSet128<RehasherExit, QuadLinear, HashCompareMurmur>, HashSet<RehasherExit, QuadLinear, HashCompareMurmur>>>, ModelChecker>(out, model);
 //    } else if(settings["storage"].asString() == "dtree2") {
 //        goDMC<llmc::storage::DTree2Storage<HashSet128<RehasherExit, QuadLinear, HashCompareMurmur>,SeparateRootSingleHashSet<HashSet<RehasherExit, QuadLinear, HashCompareMurmur>>>, ModelChecker>(fileName);
     } else {
@@ -282,15 +326,15 @@ void goSelectStorage(MessageFormatter& out, std::string fileName) {
     }
 }
 
-void go(MessageFormatter& out, std::string fileName) {
+void go(MessageFormatter& out, VModel<llmc::storage::StorageInterface>* model) {
     Settings& settings = Settings::global();
 
     if(settings["mc"].asString() == "multicore_simple") {
-        goSelectStorage<MultiCoreModelCheckerSimple>(out, fileName);
+        goSelectStorage<MultiCoreModelCheckerSimple>(out, model);
     } else if(settings["mc"].asString() == "multicore_bitbetter") {
-        goSelectStorage<MultiCoreModelChecker>(out, fileName);
+        goSelectStorage<MultiCoreModelChecker>(out, model);
     } else if(settings["mc"].asString() == "singlecore_simple") {
-        goSelectStorage<SingleCoreModelChecker>(out, fileName);
+        goSelectStorage<SingleCoreModelChecker>(out, model);
     } else {
         out.reportError("No such model checker: " + settings["mc"].asString());
     }
@@ -323,17 +367,84 @@ void printHelp(MessageFormatter& out) {
     out.message("                                - cchm: Concurrent Chaining Hash Map");
     out.message("                                - stdmap: std::unordered_map");
     out.message("  -t T, --threads T           Use T threads to model check, 0 for auto, default");
+    out.message("  --jit=on                    Compile the model in-process instead of using");
+    out.message("                              llc and cc; no intermediate files are written");
+    out.message("  --cache=on                  Reuse compiled models from the model cache");
+    out.message("  --endstates=F               Write the root of every end state to file F, one");
+    out.message("                              per line as hexadecimal slots.");
     out.message("  --listener=L                Use listener L to action upon exploration:");
     out.message("                                - dotall: all states/transistions to a DOT file");
     out.message("                                - dotend: Write end states to a DOT file");
     out.message("                                > none: Do not listen to changes.");
     out.message("");
+    out.notify("Translation Options:");
+    out.message("  --ll2dmc.threads=N          Model N processes, including main. Default: infer");
+    out.message("                              from the pthread_create calls of the program.");
+    out.message("  --ll2dmc.specialize_steps=on");
+    out.message("                              Generate a step function per process with a");
+    out.message("                              constant processor ID.");
+    out.message("  --ll2dmc.report_deltas=on   Report successors as a delta of the changed part");
+    out.message("                              of the root instead of the complete root.");
+    out.message("  --ll2dmc.por=on             Explore a single process in states where its next");
+    out.message("                              step is independent of all other processes.");
+    out.message("  --ll2dmc.collapse_thread_local=on");
+    out.message("                              Treat loads and stores of memory that is not yet");
+    out.message("                              shared with other threads as invisible.");
+    out.message("  --ll2dmc.zero_dead_registers=on");
+    out.message("                              Zero registers after their last use.");
+    out.message("                              Experimental, not validated.");
+    out.message("  --ll2dmc.inline_leaf_frames=on");
+    out.message("                              Place the registers of leaf functions after those");
+    out.message("                              of their caller instead of saving the caller's.");
+    out.message("  --ll2dmc.heap_gc=on");
+    out.message("                              Collect unreachable heap objects in every state.");
+    out.message("  --ll2dmc.heap_symmetry=on");
+    out.message("                              Relabel heap objects in a canonical order in every");
+    out.message("                              state, merging states that only differ in the");
+    out.message("                              order of allocation.");
+    out.message("  --ll2dmc.thread_symmetry=on");
+    out.message("                              Order running threads without memory by start");
+    out.message("                              routine and local state in every state, merging");
+    out.message("                              states that only differ in which process slots");
+    out.message("                              the threads run in.");
+    out.message("  --ll2dmc.paged_memory=on");
+    out.message("                              Store process memory as a tree of 256-byte pages,");
+    out.message("                              so a store only creates a new page and its path.");
+    out.message("  --ll2dmc.big_chunk_threshold=N");
+    out.message("                              Store memory and register chunks that are at least");
+    out.message("                              N bytes using the dmc_big_* API. Default: 0, off.");
+    out.message("  --ll2dmc.coalesce_stores=on");
+    out.message("                              Write consecutive stores of a transition group to");
+    out.message("                              memory as a single delta.");
+    out.message("  --ll2dmc.memory_view=on");
+    out.message("                              Serve loads close to an earlier load of the same");
+    out.message("                              step from a window instead of the storage.");
+    out.message("  --ll2dmc.checks=none|static|full");
+    out.message("                              Runtime checks of the generated code: none, only");
+    out.message("                              those that translation proves to fail (static),");
+    out.message("                              or all of them (full). Default: full.");
+    out.message("  --ll2dmc.optimize=on");
+    out.message("                              Simplify the input before translation, without");
+    out.message("                              touching memory other threads can access.");
+    out.message("  --ll2dmc.optimize_aggressive=on");
+    out.message("                              With optimize, also merge and move non-atomic");
+    out.message("                              loads and stores. Unsound if other threads can");
+    out.message("                              observe them, e.g. in spin loops.");
+    out.message("  --ll2dmc.prune_unreachable=on");
+    out.message("                              Leave out functions and globals that are not");
+    out.message("                              reachable from main or the constructors.");
+    out.message("  --ll2dmc.assume_nonatomic_collapsable=on");
+    out.message("                              Treat non-atomic loads and stores as invisible.");
+    out.message("");
     out.notify("DMC Model Checker Miscellaneous Options:");
     out.message("  --storage.stats=on          Enable storage statistics");
     out.message("  --storage.bars=N            Storage statistics uses N bars. Default 128.");
     out.message("  --storage.hashmap_scale=N   Sizes of both hashmaps. Default 28.");
     out.message("  --storage.hashmaproot_scale=N Size of hashmap for root nodes. Default 28.");
     out.message("  --storage.hashmapdata_scale=N Size of hashmap for data nodes. Default 28.");
+    out.message("  --cache.dir=D               Keep the model cache in D. Default ~/.cache/llmc.");
+    out.message("  --cache.size=N              Evict cached models beyond N MiB. Default 1024.");
+    out.message("  --cache.stats=on            Print model cache statistics");
     out.message("  --listener.writestate=on    Enable writing complete states");
     out.message("  --listener.writesubstate=on Enable writing sub-states, not only root-states");
     out.message("");
@@ -355,6 +466,8 @@ int main(int argc, char* argv[]) {
     settings["storage"] = "dtree";
     settings["storage.stats"] = 0;
     settings["storage.bars"] = 128;
+    settings["jit"] = 0;
+    settings["cache"] = 0;
 
     int verbosity = 0;
     bool doPrintHelp = false;
@@ -430,17 +543,21 @@ int main(int argc, char* argv[]) {
         exit(0);
     }
 
+    bool useJIT = settings["jit"].isOn();
+
     // Find binaries
     File bin_llc;
     File bin_cc;
     File bin_ltsmin;
     File bin_dot;
 
-    findBinary("llc", out, bin_llc);
-    if(findBinary("gcc", out, bin_cc)) {
-        findBinary("clang", out, bin_cc);
+    if(!useJIT) {
+        findBinary("llc", out, bin_llc);
+        if(findBinary("gcc", out, bin_cc)) {
+            findBinary("clang", out, bin_cc);
+        }
+        findBinary("dot", out, bin_dot);
     }
-    findBinary("dot", out, bin_dot);
 
     int htindex = optind;
 
@@ -458,7 +575,7 @@ int main(int argc, char* argv[]) {
     File output_png = input.newWithExtension("png");
 
     if(input.getFileExtension()=="so") {
-        go(out, input.getFileRealPath());
+        go(out, DMCModel::get(input.getFileRealPath()));
         return 0;
     }
 
@@ -474,6 +591,10 @@ int main(int argc, char* argv[]) {
     }
 
     for(auto& f: {output_ll, output_o, output_so}) {
+        if(useJIT) {
+            // No intermediate files are written
+            break;
+        }
         if(FileSystem::isDir(f)) {
             out.reportError("Output file (" + f.getFilePath() + ") is a directory");
             exit(1);
@@ -484,12 +605,35 @@ int main(int argc, char* argv[]) {
         }
     }
 
+    // A cached model skips translation, compilation and linking
+    std::unique_ptr<ModelCache> cache;
+    std::string cacheKey;
+    if(settings["cache"].isOn() && !useJIT) {
+        cache = std::make_unique<ModelCache>(out, settings.getSubSection("cache"));
+        cacheKey = cache->keyFor(input, settings.getSubSection("ll2dmc"));
+        File cachedModel;
+        if(cache->lookup(cacheKey, cachedModel)) {
+            if(settings["cache.stats"].isOn()) {
+                cache->reportStatistics();
+            }
+            go(out, DMCModel::get(cachedModel.getFileRealPath()));
+            return 0;
+        }
+    }
+
     // .ll -> .dmc.ll
     out.reportAction("Translating LLVM IR...");
+    PhaseTimer timer(out);
     llmc::ll2dmc translator(out);
-    translator.init(input, settings.getSubSection("ll2dmc"));
+    if(!translator.init(input, settings.getSubSection("ll2dmc"))) {
+        out.reportError("Translation failed");
+        exit(1);
+    }
     auto r = translator.translate();
-    translator.writeTo(output_ll);
+    timer.report();
+    if(!useJIT) {
+        translator.writeTo(output_ll);
+    }
     if(!r) {
         out.reportError("Translation failed");
         exit(1);
@@ -499,6 +643,44 @@ int main(int argc, char* argv[]) {
         exit(1);
     }
 
+    if(useJIT) {
+
+        // .dmc.ll -> in-memory model, linked with the LLMC VM
+        out.notify("Linking...");
+        auto model = translator.takeModule();
+        timer.report();
+        if(!model) {
+            out.reportError("Linking failed");
+            exit(1);
+        }
+        out.reportSuccess("Linking successful");
+
+        // Compilation happens lazily on the first lookup
+        out.notify("Compiling...");
+        llmc::ModelJIT jit(out);
+        auto initialstate = jit.addModule(std::move(model))
+                          ? jit.lookup<JITModel::dmc_initialstate_t>("dmc_initialstate")
+                          : nullptr;
+        auto nextstates = initialstate
+                        ? jit.lookup<JITModel::dmc_nextstates_t>("dmc_nextstates")
+                        : nullptr;
+        timer.report();
+        if(!initialstate || !nextstates || !jit.initialize()) {
+            out.reportError("Compilation failed");
+            exit(1);
+        }
+        out.reportSuccess("Compilation successful");
+
+        out.reportAction("Exploring the state space using the following settings");
+        out.indent();
+        out.reportNote("search core:   " + settings["mc"].asString());
+        out.reportNote("state storage: " + settings["storage"].asString());
+        out.outdent();
+        JITModel jitModel(initialstate, nextstates);
+        go(out, &jitModel);
+        return 0;
+    }
+
     // .dmc.ll -> .o
     FileSystem::remove(output_o);
     if(compile(bin_llc, output_ll, output_o, out)) {
@@ -514,6 +696,13 @@ int main(int argc, char* argv[]) {
     }
     out.reportSuccess("Linking successful");
 
+    if(cache) {
+        cache->store(cacheKey, output_so);
+        if(settings["cache.stats"].isOn()) {
+            cache->reportStatistics();
+        }
+    }
+
     // LTSmin
 //    if(model_check(bin_ltsmin, output_so, output_dot, out)) {
 //        out.reportError("Model checking failed");
@@ -531,7 +720,7 @@ int main(int argc, char* argv[]) {
     out.reportNote("search core:   " + settings["mc"].asString());
     out.reportNote("state storage: " + settings["storage"].asString());
     out.outdent();
-    go(out, output_so.getFileRealPath());
+    go(out, DMCModel::get(output_so.getFileRealPath()));
 
     return 0;
 }
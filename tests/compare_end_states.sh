@@ -0,0 +1,103 @@
+#!/bin/sh
+#
+# LLMC - LLVM IR Model Checker
+# Copyright © 2013-2021 Freark van der Berg
+#
+# This file is part of LLMC.
+#
+# LLMC is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, version 3 of the License.
+#
+# LLMC is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with LLMC.  If not, see <https://www.gnu.org/licenses/>.
+#
+# Compares the end states found with a reduction enabled against those of
+# full exploration, for every test directory given. Both runs write the root
+# of every end state (--endstates) and the sorted sets of roots must be equal.
+#
+# Usage: compare_end_states.sh [-s] LLMC OPTION TESTDIR...
+#   LLMC     the llmc binary
+#   OPTION   the option enabling the reduction, e.g. --ll2dmc.por=on
+#   TESTDIR  a directory containing a test.c
+#   -s       only compare whether there are end states that are OK and
+#            end states with issues, not the end states themselves. Use this
+#            for reductions that change the end states, like the symmetry
+#            reductions, which keep only a canonical representative.
+#
+# Roots refer to the memory, stacks and globals by the chunk IDs the storage
+# assigned. The dtree storage (the default) derives these from the content of
+# the chunk, so equal chunks have equal IDs in both runs; with storages that
+# number chunks in insertion order the roots are not comparable.
+#
+# The environment variables CLANG and CFLAGS select the compiler and flags
+# used to translate test.c to LLVM IR. The exit code is the number of tests
+# of which the end states differ.
+
+CLANG=${CLANG:-clang}
+CFLAGS=${CFLAGS:--O1}
+
+presence=0
+if [ "$1" = "-s" ]; then
+    presence=1
+    shift
+fi
+if [ $# -lt 3 ]; then
+    echo "Usage: $0 [-s] LLMC OPTION TESTDIR..."
+    exit 255
+fi
+llmc=$1
+option=$2
+shift 2
+
+tmp=$(mktemp -d)
+trap 'rm -rf "$tmp"' EXIT
+
+# Runs llmc with the arguments, writes the sorted roots of the end states to
+# the file $1 and prints "<end states> <OK> <with issues>"
+endStates() {
+    file=$1
+    shift
+    "$llmc" --endstates="$file.unsorted" "$@" 2>&1 | sed 's/\x1b\[[0-9;]*m//g' | awk '
+        /End states \(/ { gsub(/.*\(|\).*/, ""); total = $0 }
+        / end states OK/ { ok = $1 }
+        / end states with issues/ { issues = $1 }
+        END { printf "%d %d %d\n", total, ok, issues }
+    '
+    touch "$file.unsorted"
+    sort "$file.unsorted" > "$file"
+}
+
+failed=0
+for dir in "$@"; do
+    ll="$dir/test.ll"
+    if ! $CLANG $CFLAGS -S -emit-llvm -o "$ll" "$dir/test.c"; then
+        echo "SKIP $dir: could not compile test.c"
+        continue
+    fi
+    full=$(endStates "$tmp/full" "$ll")
+    reduced=$(endStates "$tmp/reduced" "$option" "$ll")
+    if [ $presence -eq 1 ]; then
+        full=$(echo "$full" | awk '{ print ($1 > 0), ($2 > 0), ($3 > 0) }')
+        reduced=$(echo "$reduced" | awk '{ print ($1 > 0), ($2 > 0), ($3 > 0) }')
+        same=$([ "$full" = "$reduced" ] && echo 1 || echo 0)
+    else
+        same=$(cmp -s "$tmp/full" "$tmp/reduced" && echo 1 || echo 0)
+    fi
+    if [ $same -eq 1 ]; then
+        echo "OK   $dir: $full"
+    else
+        echo "FAIL $dir: full exploration $full, with $option $reduced"
+        if [ $presence -eq 0 ]; then
+            echo "     only with full exploration: $(comm -23 "$tmp/full" "$tmp/reduced" | wc -l) end states"
+            echo "     only with $option: $(comm -13 "$tmp/full" "$tmp/reduced" | wc -l) end states"
+        fi
+        failed=$((failed + 1))
+    fi
+done
+exit $failed
@@ -0,0 +1,11 @@
+#include <stdlib.h>
+
+// The second free() is a double free, so every end state has an issue
+int main(int argc, char** argv) {
+	int* a = malloc(sizeof(int));
+	int* b = malloc(sizeof(int));
+	free(a);
+	free(a);
+	free(b);
+	return 0;
+}
@@ -0,0 +1,17 @@
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+// Freeing the last object gives its memory back, so the next allocation of
+// the same size gets the same address
+int main(int argc, char** argv) {
+	int* a = malloc(sizeof(int));
+	int* b = malloc(sizeof(int));
+	uintptr_t last = (uintptr_t)b;
+	free(b);
+	int* c = malloc(sizeof(int));
+	assert((uintptr_t)c == last);
+	free(c);
+	free(a);
+	return 0;
+}
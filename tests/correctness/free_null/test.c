@@ -0,0 +1,11 @@
+#include <assert.h>
+#include <stdlib.h>
+
+int main(int argc, char** argv) {
+	int* a = malloc(sizeof(int));
+	*a = 3;
+	free(NULL);
+	assert(*a == 3);
+	free(a);
+	return 0;
+}
@@ -0,0 +1,15 @@
+#include <assert.h>
+#include <stdlib.h>
+
+int main(int argc, char** argv) {
+	int* a = malloc(sizeof(int) * 4);
+	int* b = malloc(sizeof(int));
+	a[0] = 1;
+	a[3] = 4;
+	*b = 5;
+	assert(a[0] + a[3] == *b);
+	free(a);
+	assert(*b == 5);
+	free(b);
+	return 0;
+}
@@ -0,0 +1,22 @@
+#include <assert.h>
+
+int main(int argc, char** argv) {
+	int i;
+	switch(argc) {
+	case 0:
+		i = 2;
+		break;
+	case 1:
+	case 3:
+		i = 5;
+		break;
+	case 7:
+		i = 9;
+		break;
+	default:
+		i = 1;
+		break;
+	}
+	assert(i==2); // argc is 0 for now
+	return i;
+}
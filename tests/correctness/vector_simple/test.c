@@ -0,0 +1,18 @@
+#include <assert.h>
+
+typedef int v4si __attribute__((vector_size(16)));
+
+v4si g = {1, 2, 3, 4};
+int after = 5;
+
+int main(int argc, char** argv) {
+	v4si v = g + (v4si){10, 20, 30, 40};
+	v4si r = __builtin_shufflevector(v, v, 3, 2, 1, 0);
+	g = r;
+	assert(g[0] == 44);
+	assert(g[1] == 33);
+	assert(g[2] == 22);
+	assert(g[3] == 11);
+	assert(after == 5);
+	return 0;
+}
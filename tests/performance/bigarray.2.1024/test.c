@@ -0,0 +1,4 @@
+#define ELEMENTS 1024
+#define THREADS 2
+
+#include "../bigarray/test.c"
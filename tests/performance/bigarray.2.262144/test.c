@@ -0,0 +1,4 @@
+#define ELEMENTS 262144
+#define THREADS 2
+
+#include "../bigarray/test.c"
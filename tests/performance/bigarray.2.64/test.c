@@ -0,0 +1,4 @@
+#define ELEMENTS 64
+#define THREADS 2
+
+#include "../bigarray/test.c"
@@ -0,0 +1,43 @@
+#include <assert.h>
+#include <pthread.h>
+
+// Every thread updates a few elements of one large global array. The number
+// of states does not depend on ELEMENTS, only the size of the memory chunk
+// does, so running this for several values of ELEMENTS with and without
+// --ll2dmc.big_chunk_threshold shows from which chunk size on the dmc_big_*
+// API is faster for a storage.
+
+#ifndef ELEMENTS
+#define ELEMENTS 16
+#endif
+#ifndef THREADS
+#define THREADS 2
+#endif
+#ifndef UPDATES
+#define UPDATES 4
+#endif
+
+int data[ELEMENTS];
+pthread_t th[THREADS];
+
+void* update(void* arg) {
+	int tid = (int)(long)arg;
+	for(int i = 0; i < UPDATES; ++i) {
+		int index = (tid * UPDATES + i) * (ELEMENTS / (THREADS * UPDATES));
+		__atomic_fetch_add(&data[index], 1, __ATOMIC_SEQ_CST);
+		__atomic_fetch_add(&data[ELEMENTS-1], 1, __ATOMIC_SEQ_CST);
+	}
+	return NULL;
+}
+
+int main(int argc, char** argv) {
+	for(int t = 1; t < THREADS; ++t) {
+		pthread_create(&th[t], 0, &update, (void*)(long)t);
+	}
+	update((void*)0);
+	for(int t = 1; t < THREADS; ++t) {
+		pthread_join(th[t], NULL);
+	}
+	assert(__atomic_load_n(&data[ELEMENTS-1], __ATOMIC_SEQ_CST) == THREADS * UPDATES);
+	return 0;
+}